@@ -0,0 +1,208 @@
+////////////////////////////////////////////////////////////////////////////////
+// LPC43XX_GPDMA.cpp - GPDMA functions for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+
+#include <tinyhal.h>
+#include "LPC43XX.h"
+#include "LPC43XX_GPDMA.h"
+
+// Shared GPDMA controller. Drivers allocate a channel with a completion
+// callback, which is invoked from the DMA ISR on terminal count or error.
+
+#define GPDMA_FLOW_MASK     (7 << 11)
+#define GPDMA_STOP_TIMEOUT  1000
+
+typedef struct
+{
+  GPDMA_CALLBACK_FPN isr;
+  void* param;
+  BOOL used;
+} GPDMA_CH_T;
+
+static GPDMA_CH_T gpdma_ch[GPDMA_CHANNELS];
+static BOOL g_gpdmaInit = FALSE;
+
+// GPDMA interrupt handler
+void GPDMA_IRQHandler(void* param);
+
+// ---------------------------------------------------------------------------
+void GPDMA_IRQHandler(void* param)
+{
+    UINT32 tc  = LPC_GPDMA->INTTCSTAT;
+    UINT32 err = LPC_GPDMA->INTERRSTAT;
+
+    LPC_GPDMA->INTTCCLEAR = tc;
+    LPC_GPDMA->INTERRCLR = err;
+
+    for (int ch = 0; ch < GPDMA_CHANNELS; ch++)
+    {
+        UINT32 status = 0;
+        if (tc  & (1 << ch)) status |= GPDMA_STATUS_TC;
+        if (err & (1 << ch)) status |= GPDMA_STATUS_ERR;
+        if (status && gpdma_ch[ch].isr)
+        {
+            gpdma_ch[ch].isr(gpdma_ch[ch].param, status);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+int GPDMA_ChannelAlloc(GPDMA_CALLBACK_FPN isr, void* param)
+{
+    GLOBAL_LOCK(irq);
+
+    if (!g_gpdmaInit)
+    {
+        // Enable controller, little endian on both masters
+        LPC_GPDMA->CONFIG = 1;
+        LPC_GPDMA->INTTCCLEAR = 0xFF;
+        LPC_GPDMA->INTERRCLR = 0xFF;
+        CPU_INTC_ActivateInterrupt(DMA_IRQn, GPDMA_IRQHandler, 0);
+        g_gpdmaInit = TRUE;
+    }
+
+    for (int ch = 0; ch < GPDMA_CHANNELS; ch++)
+    {
+        if (!gpdma_ch[ch].used)
+        {
+            gpdma_ch[ch].used = TRUE;
+            gpdma_ch[ch].isr = isr;
+            gpdma_ch[ch].param = param;
+            return ch;
+        }
+    }
+    return -1; // No channels available
+}
+
+// ---------------------------------------------------------------------------
+void GPDMA_ChannelFree(int ch)
+{
+    if (ch < 0 || ch >= GPDMA_CHANNELS) return;
+
+    GPDMA_Stop(ch);
+
+    GLOBAL_LOCK(irq);
+    gpdma_ch[ch].used = FALSE;
+    gpdma_ch[ch].isr = NULL;
+    gpdma_ch[ch].param = NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Starts a transfer on a channel. ctrl is the CONTROL word for the first item,
+// config is the flow control with optional flags. For peripheral transfers
+// req selects the request line and sets DMAMUX.
+BOOL GPDMA_Transfer(int ch, UINT32 src, UINT32 dst, UINT32 ctrl,
+                    UINT32 req, UINT32 config, const GPDMA_LLI_T* lli)
+{
+    if (ch < 0 || ch >= GPDMA_CHANNELS) return FALSE;
+
+    LPC_GPDMA_CH_T *dma = &LPC_GPDMA->CH[ch];
+
+    GLOBAL_LOCK(irq);
+
+    if (dma->CONFIG & GPDMA_CFG_ENABLE) return FALSE; // Channel busy
+
+    if (req != GPDMA_REQ_NONE)
+    {
+        UINT32 line = GPDMA_REQ_LINE(req);
+        LPC_CREG->DMAMUX = (LPC_CREG->DMAMUX & ~(3 << (line * 2)))
+                           | (GPDMA_REQ_SEL(req) << (line * 2));
+        if ((config & GPDMA_FLOW_MASK) == GPDMA_CFG_P2M)
+            config |= GPDMA_CFG_SRC_PERIPH(line);
+        else if ((config & GPDMA_FLOW_MASK) == GPDMA_CFG_M2P)
+            config |= GPDMA_CFG_DST_PERIPH(line);
+    }
+
+    LPC_GPDMA->INTTCCLEAR = (1 << ch);
+    LPC_GPDMA->INTERRCLR = (1 << ch);
+    dma->SRCADDR = src;
+    dma->DESTADDR = dst;
+    dma->LLI = (UINT32)lli;
+    dma->CONTROL = ctrl;
+    dma->CONFIG = config | GPDMA_CFG_ERR_IRQ | GPDMA_CFG_TC_IRQ | GPDMA_CFG_ENABLE;
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Halts the channel and waits for the FIFO to drain before disabling it
+void GPDMA_Stop(int ch)
+{
+    if (ch < 0 || ch >= GPDMA_CHANNELS) return;
+
+    LPC_GPDMA_CH_T *dma = &LPC_GPDMA->CH[ch];
+    int timeout = GPDMA_STOP_TIMEOUT;
+
+    if (!(dma->CONFIG & GPDMA_CFG_ENABLE)) return;
+
+    dma->CONFIG |= GPDMA_CFG_HALT;
+    while ((dma->CONFIG & GPDMA_CFG_ACTIVE) && --timeout);
+    dma->CONFIG &= ~(GPDMA_CFG_ENABLE | GPDMA_CFG_HALT);
+    LPC_GPDMA->INTTCCLEAR = (1 << ch);
+    LPC_GPDMA->INTERRCLR = (1 << ch);
+}
+
+// ---------------------------------------------------------------------------
+// Holds off further peripheral requests without losing channel state
+void GPDMA_Halt(int ch, BOOL halt)
+{
+    if (ch < 0 || ch >= GPDMA_CHANNELS) return;
+
+    if (halt)
+        LPC_GPDMA->CH[ch].CONFIG |= GPDMA_CFG_HALT;
+    else
+        LPC_GPDMA->CH[ch].CONFIG &= ~GPDMA_CFG_HALT;
+}
+
+// ---------------------------------------------------------------------------
+BOOL GPDMA_Busy(int ch)
+{
+    if (ch < 0 || ch >= GPDMA_CHANNELS) return FALSE;
+    return (LPC_GPDMA->ENBLDCHNS & (1 << ch)) ? TRUE : FALSE;
+}
+
+// ---------------------------------------------------------------------------
+// Bus error since the transfer started, for callers polling with interrupts
+// disabled. The interrupt handler clears it before calling back.
+BOOL GPDMA_Error(int ch)
+{
+    if (ch < 0 || ch >= GPDMA_CHANNELS) return FALSE;
+    return (LPC_GPDMA->RAWINTERRSTAT & (1 << ch)) ? TRUE : FALSE;
+}
+
+// ---------------------------------------------------------------------------
+// Transfers left in the current linked list item
+UINT32 GPDMA_Remaining(int ch)
+{
+    if (ch < 0 || ch >= GPDMA_CHANNELS) return 0;
+    return GPDMA_CTRL_SIZE(LPC_GPDMA->CH[ch].CONTROL);
+}
+
+// ---------------------------------------------------------------------------
+// Current source and destination addresses, used to track circular transfers
+UINT32 GPDMA_SrcAddress(int ch)
+{
+    if (ch < 0 || ch >= GPDMA_CHANNELS) return 0;
+    return LPC_GPDMA->CH[ch].SRCADDR;
+}
+
+// ---------------------------------------------------------------------------
+UINT32 GPDMA_DestAddress(int ch)
+{
+    if (ch < 0 || ch >= GPDMA_CHANNELS) return 0;
+    return LPC_GPDMA->CH[ch].DESTADDR;
+}
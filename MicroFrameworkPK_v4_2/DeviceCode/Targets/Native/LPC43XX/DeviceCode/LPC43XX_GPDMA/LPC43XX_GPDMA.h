@@ -0,0 +1,116 @@
+////////////////////////////////////////////////////////////////////////////////
+// LPC43XX_GPDMA.h - GPDMA declarations for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _LPC43XX_GPDMA_H_
+#define _LPC43XX_GPDMA_H_
+
+// Peripheral request lines. Low byte is the request line used in the channel
+// CONFIG register, high byte is the selection for that line in CREG DMAMUX.
+#define GPDMA_REQ(line, sel)      ((line) | ((sel) << 8))
+#define GPDMA_REQ_LINE(req)       ((req) & 0x0F)
+#define GPDMA_REQ_SEL(req)        (((req) >> 8) & 0x03)
+
+#define GPDMA_REQ_SPIFI           GPDMA_REQ(0, 0)
+#define GPDMA_REQ_USART0_TX       GPDMA_REQ(1, 1)
+#define GPDMA_REQ_USART0_RX       GPDMA_REQ(2, 1)
+#define GPDMA_REQ_UART1_TX        GPDMA_REQ(3, 1)
+#define GPDMA_REQ_UART1_RX        GPDMA_REQ(4, 1)
+#define GPDMA_REQ_USART2_TX       GPDMA_REQ(5, 1)
+#define GPDMA_REQ_USART2_RX       GPDMA_REQ(6, 1)
+#define GPDMA_REQ_USART3_TX       GPDMA_REQ(7, 1)
+#define GPDMA_REQ_USART3_RX       GPDMA_REQ(8, 1)
+#define GPDMA_REQ_SSP0_RX         GPDMA_REQ(9, 0)
+#define GPDMA_REQ_SSP0_TX         GPDMA_REQ(10, 0)
+#define GPDMA_REQ_SSP1_RX         GPDMA_REQ(11, 0)
+#define GPDMA_REQ_SSP1_TX         GPDMA_REQ(12, 0)
+#define GPDMA_REQ_NONE            0xFFFF  // Memory to memory
+
+// Channel CONTROL register fields
+#define GPDMA_CTRL_SIZE(n)        ((n) & 0xFFF)   // Transfer size
+#define GPDMA_CTRL_SBSIZE(n)      ((n) << 12)     // Source burst size
+#define GPDMA_CTRL_DBSIZE(n)      ((n) << 15)     // Destination burst size
+#define GPDMA_CTRL_SWIDTH(n)      ((n) << 18)     // Source width
+#define GPDMA_CTRL_DWIDTH(n)      ((n) << 21)     // Destination width
+#define GPDMA_CTRL_SRC_AHB1       (1 << 24)       // Source AHB master 1
+#define GPDMA_CTRL_DST_AHB1       (1 << 25)       // Destination AHB master 1
+#define GPDMA_CTRL_SRC_INC        (1 << 26)       // Source increment
+#define GPDMA_CTRL_DST_INC        (1 << 27)       // Destination increment
+#define GPDMA_CTRL_TC_IRQ         (1UL << 31)     // Terminal count interrupt
+
+#define GPDMA_MAX_SIZE            0xFFF           // Max transfers per item
+
+// Burst sizes
+#define GPDMA_BURST_1             0
+#define GPDMA_BURST_4             1
+#define GPDMA_BURST_8             2
+#define GPDMA_BURST_16            3
+// Transfer widths
+#define GPDMA_WIDTH_BYTE          0
+#define GPDMA_WIDTH_HALFWORD      1
+#define GPDMA_WIDTH_WORD          2
+
+// Channel CONFIG register fields
+#define GPDMA_CFG_ENABLE          (1 << 0)
+#define GPDMA_CFG_SRC_PERIPH(n)   ((n) << 1)
+#define GPDMA_CFG_DST_PERIPH(n)   ((n) << 6)
+#define GPDMA_CFG_M2M             (0 << 11)
+#define GPDMA_CFG_M2P             (1 << 11)
+#define GPDMA_CFG_P2M             (2 << 11)
+#define GPDMA_CFG_ERR_IRQ         (1 << 14)
+#define GPDMA_CFG_TC_IRQ          (1 << 15)
+#define GPDMA_CFG_ACTIVE          (1 << 17)
+#define GPDMA_CFG_HALT            (1 << 18)
+
+// Callback status flags
+#define GPDMA_STATUS_TC           (1 << 0)
+#define GPDMA_STATUS_ERR          (1 << 1)
+
+// DMA buffers and linked list items are placed in SectionForDMA (AHB SRAM)
+#ifndef ALIGNED
+#if defined(__ARMCC_VERSION)
+  #define ALIGNED(n)  __align(n)
+#else
+  #define ALIGNED(n)  __attribute__((aligned (n)))
+#endif
+#endif
+
+// Linked list item. Must be word aligned in memory reachable by the GPDMA.
+typedef struct
+{
+  UINT32 src;
+  UINT32 dst;
+  UINT32 lli;
+  UINT32 ctrl;
+} GPDMA_LLI_T;
+
+typedef void (*GPDMA_CALLBACK_FPN)(void* param, UINT32 status);
+
+int    GPDMA_ChannelAlloc(GPDMA_CALLBACK_FPN isr, void* param);
+void   GPDMA_ChannelFree(int ch);
+BOOL   GPDMA_Transfer(int ch, UINT32 src, UINT32 dst, UINT32 ctrl,
+                      UINT32 req, UINT32 config, const GPDMA_LLI_T* lli);
+void   GPDMA_Stop(int ch);
+void   GPDMA_Halt(int ch, BOOL halt);
+BOOL   GPDMA_Busy(int ch);
+BOOL   GPDMA_Error(int ch);
+UINT32 GPDMA_Remaining(int ch);
+UINT32 GPDMA_SrcAddress(int ch);
+UINT32 GPDMA_DestAddress(int ch);
+
+#endif // _LPC43XX_GPDMA_H_
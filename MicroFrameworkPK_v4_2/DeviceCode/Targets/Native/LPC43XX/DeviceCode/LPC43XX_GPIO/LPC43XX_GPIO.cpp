@@ -215,7 +215,7 @@ void CPU_GPIO_DisablePin(GPIO_PIN Pin, GPIO_RESISTOR ResistorState, UINT32 Direc
 
     for (int i = 0; i < TOTAL_GPIO_INT; i++)
     {
-        *obj = gpio_irq[i];
+        obj = &gpio_irq[i];
 
         if (obj->pin == Pin)
         {
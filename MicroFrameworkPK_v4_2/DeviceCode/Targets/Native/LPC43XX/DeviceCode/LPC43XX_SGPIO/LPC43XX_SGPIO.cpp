@@ -0,0 +1,340 @@
+////////////////////////////////////////////////////////////////////////////////
+// LPC43XX_SGPIO.cpp - SGPIO functions for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+
+#include <tinyhal.h>
+#include "LPC43XX.h"
+#include "LPC43XX_PINS.h"
+#include "LPC43XX_SGPIO.h"
+
+// Data lanes come from slice A and its concatenated chain, the shift clock
+// from slice B on SGPIO8. All slices share PRESET and POS and are started
+// together, so the clock and the data stay in step. When POS runs out the
+// chain swaps REG with REG_SS and slice A raises the exchange interrupt,
+// which refills (TX) or drains (RX) the shadow registers for the next block.
+// CTRL_DISABLED stops the slices at the end of the last block.
+//
+// The shift clock is the core clock divided by PRESET + 1, so every block
+// takes a fixed number of core cycles. The handler works out from POS and
+// COUNT when the exchange it serves happened and fails the transfer if a
+// whole block went by unserved, or if the next exchange came before it was
+// done with the shadow registers.
+
+#define SGPIO_SLICE_A     0
+#define SGPIO_SLICE_B     1
+#define SGPIO_CLK_PIN     8
+#define SGPIO_PINS        9   // SGPIO0..7 data, SGPIO8 clock
+
+// Concatenation order of slice A, REG_SS of the last slice holds the first
+// word of a block
+static UINT8 const SGPIO_Chain[8] = {0, 8, 4, 9, 2, 10, 5, 11}; // A I E J C K F L
+
+typedef struct
+{
+  GPIO_PIN pin;
+  UINT8 func;       // SCU function
+} SGPIO_PIN_T;
+
+static SGPIO_PIN_T const SGPIO_Pin[SGPIO_PINS] = {
+    {(GPIO_PIN)P0_0, 3}, {(GPIO_PIN)P0_1, 3}, {(GPIO_PIN)P1_15, 2}, {(GPIO_PIN)P1_16, 2},
+    {(GPIO_PIN)P6_3, 2}, {(GPIO_PIN)P6_6, 2}, {(GPIO_PIN)P2_2, 0},  {(GPIO_PIN)P1_0, 6},
+    {(GPIO_PIN)P4_2, 7}};
+
+// SGPIO_MUX_CFG fields
+#define SGPIO_MUX_CONCAT          (1 << 11)       // Data from the chain
+#define SGPIO_MUX_ORDER(n)        ((n) << 12)     // 0 self loop, 1..3 = 2..8 slices
+// SLICE_MUX_CFG fields
+#define SGPIO_SLICE_INV_CLK       (1 << 3)        // Invert clock out
+#define SGPIO_SLICE_PARALLEL(n)   ((n) << 6)      // 0..3 = 1..8 bits per shift
+// OUT_MUX_CFG fields, output enable always from GPIO_OENREG
+#define SGPIO_OUT_DOUT1           0x0             // dout_doutm1
+#define SGPIO_OUT_DOUT2           0x1             // dout_doutm2a
+#define SGPIO_OUT_CLK             0x8             // clk_out
+#define SGPIO_OUT_DOUT4           0x5             // dout_doutm4a
+#define SGPIO_OUT_DOUT8           0x9             // dout_doutm8a
+// POS fields
+#define SGPIO_POS(n)              ((n) | (n) << 8) // POS and POS_RESET
+
+#define SGPIO_PRESET_MAX          0xFFF
+#define SGPIO_COUNT_MASK          0xFFF
+#define SGPIO_POS_MASK            0xFF
+// Shortest block, in core cycles, the exchange handler can keep up with
+// including interrupt latency and flash wait states
+#define SGPIO_BLOCK_CYCLES_MIN    1024
+
+typedef struct
+{
+  UINT8* buf;
+  UINT32 blocks;      // Blocks in the transfer
+  UINT32 exchanges;   // Exchange interrupts so far
+  UINT32 slices;
+  UINT32 mask;        // Slices running
+  UINT32 preset;      // Core cycles per shift - 1
+  UINT32 pos;         // Shifts per block - 1
+  UINT32 cycles;      // Core cycles per block
+  UINT32 last;        // Cycle count at the last exchange
+  BOOL receive;
+  BOOL busy;
+  BOOL init;
+  BOOL muxed;
+  volatile INT32* status;
+  HAL_COMPLETION* completion;
+} SGPIO_T;
+
+static SGPIO_T sgpio;
+
+// SGPIO interrupt handler
+void SGPIO_IRQHandler(void* param);
+
+// Local functions
+static inline UINT32 SGPIO_Log2(UINT32 n);
+static void SGPIO_Load(const UINT8* p, UINT32 slices);
+static void SGPIO_Save(UINT8* p, UINT32 slices);
+static void SGPIO_Finish(INT32 Status);
+
+// ---------------------------------------------------------------------------
+// Exchange on slice A, REG now shifts the block after the one in REG_SS
+void SGPIO_IRQHandler(void* param)
+{
+    SGPIO_T *s = &sgpio;
+    UINT32 n = SGPIO_BLOCK_SIZE(s->slices);
+    UINT32 now = DWT->CYCCNT;
+    UINT32 pos = LPC_SGPIO->POS[SGPIO_SLICE_A] & SGPIO_POS_MASK;
+    UINT32 count = LPC_SGPIO->COUNT[SGPIO_SLICE_A] & SGPIO_COUNT_MASK;
+    UINT32 at;
+    BOOL moved = FALSE;
+
+    LPC_SGPIO->CTR_STATUS_1 = 1 << SGPIO_SLICE_A;
+    if (!s->busy) return;
+
+    // Cycle of the latest exchange, one block after the previous one unless
+    // the interrupt came so late that a block shifted stale REG_SS data. The
+    // slices stop after the last block, its exchange can be served late.
+    at = now - (s->pos - pos) * (s->preset + 1) - (s->preset - count);
+    if (s->exchanges + 1 < s->blocks && at - s->last > s->cycles + s->cycles / 2)
+    {
+        SGPIO_Finish(SGPIO_ERROR);
+        return;
+    }
+    s->last = at;
+
+    s->exchanges++;
+    if (s->receive)
+    {
+        SGPIO_Save(s->buf + (s->exchanges - 1) * n, s->slices);
+        moved = TRUE;
+    }
+    else if (s->exchanges + 1 < s->blocks)
+    {
+        SGPIO_Load(s->buf + (s->exchanges + 1) * n, s->slices);
+        moved = TRUE;
+    }
+
+    if (s->exchanges >= s->blocks) SGPIO_Finish(SGPIO_DONE);
+    else if (moved && (LPC_SGPIO->CTR_STATUS_1 & (1 << SGPIO_SLICE_A)))
+    {
+        // Exchanged again while the shadow registers were being moved
+        SGPIO_Finish(SGPIO_ERROR);
+    }
+    else if (s->exchanges + 1 == s->blocks) LPC_SGPIO->CTRL_DISABLED = s->mask; // Last block
+}
+
+// ---------------------------------------------------------------------------
+static inline UINT32 SGPIO_Log2(UINT32 n)
+{
+    return (n >= 8) ? 3 : (n >= 4) ? 2 : (n >= 2) ? 1 : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Block to the shadow registers. Managed buffers need not be word aligned,
+// memcpy compiles to an unaligned load.
+static void SGPIO_Load(const UINT8* p, UINT32 slices)
+{
+    UINT32 w;
+
+    for (UINT32 k = 0; k < slices; k++, p += 4)
+    {
+        memcpy(&w, p, 4);
+        LPC_SGPIO->REG_SS[SGPIO_Chain[slices - 1 - k]] = w;
+    }
+}
+
+// ---------------------------------------------------------------------------
+static void SGPIO_Save(UINT8* p, UINT32 slices)
+{
+    UINT32 w;
+
+    for (UINT32 k = 0; k < slices; k++, p += 4)
+    {
+        w = LPC_SGPIO->REG_SS[SGPIO_Chain[slices - 1 - k]];
+        memcpy(p, &w, 4);
+    }
+}
+
+// ---------------------------------------------------------------------------
+static void SGPIO_Finish(INT32 Status)
+{
+    SGPIO_T *s = &sgpio;
+
+    LPC_SGPIO->CLR_EN_1 = 1 << SGPIO_SLICE_A;
+    LPC_SGPIO->CTRL_ENABLED = 0;
+    LPC_SGPIO->CTRL_DISABLED = 0;
+    s->busy = FALSE;
+    if (s->status) *s->status = Status;
+    if (s->completion) s->completion->EnqueueDelta(0);
+}
+
+// ---------------------------------------------------------------------------
+BOOL SGPIO_Transfer(const SGPIO_CONFIGURATION& Config, UINT8* Buffer, UINT32 Count,
+                    volatile INT32* Status, HAL_COMPLETION* Completion)
+{
+    SGPIO_T *s = &sgpio;
+    UINT32 n = SGPIO_BLOCK_SIZE(Config.Slices);
+    UINT32 width = SGPIO_Log2(Config.Width);
+    UINT32 order = SGPIO_Log2(Config.Slices);
+    UINT32 preset, pos, cfg, out, i;
+
+    if (Config.Width != (1u << width) || Config.Width > 8) return FALSE;
+    if (Config.Slices != (1u << order) || Config.Slices > 8) return FALSE;
+    if (Buffer == NULL || Count == 0 || Count % n) return FALSE;
+    if (Config.ClockKHz == 0) return FALSE;
+
+    preset = (SystemCoreClock + 500 * Config.ClockKHz) / (1000 * Config.ClockKHz);
+    preset = (preset) ? preset - 1 : 0;
+    if (preset > SGPIO_PRESET_MAX) return FALSE;
+    pos = 32 / Config.Width * Config.Slices - 1; // Shifts per block
+    if ((preset + 1) * (pos + 1) < SGPIO_BLOCK_CYCLES_MIN) return FALSE; // Clock too fast
+
+    GLOBAL_LOCK(irq);
+
+    if (s->busy) return FALSE;
+    if (!s->init)
+    {
+        // Peripheral base clock from PLL1, same rate as the core
+        LPC_CGU->BASE_CLK[CLK_BASE_PERIPH] = (1 << 11) | (CLKIN_PLL1 << 24);
+        CPU_INTC_ActivateInterrupt(SGPIO_INT_IRQn, SGPIO_IRQHandler, 0);
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+        s->init = TRUE;
+    }
+
+    s->buf = Buffer;
+    s->blocks = Count / n;
+    s->exchanges = 0;
+    s->slices = Config.Slices;
+    s->receive = Config.Receive;
+    s->status = Status;
+    s->completion = Completion;
+    s->mask = 1 << SGPIO_SLICE_B;
+    s->preset = preset;
+    s->pos = pos;
+    s->cycles = (preset + 1) * (pos + 1);
+
+    LPC_SGPIO->CTRL_ENABLED = 0;
+    LPC_SGPIO->CTRL_DISABLED = 0;
+    LPC_SGPIO->CLR_EN_1 = 0xFFFF;
+    LPC_SGPIO->CTR_STATUS_1 = 0xFFFF;
+
+    // Data chain. Slice A captures from the pins when receiving, otherwise
+    // every slice takes its input from the chain.
+    for (i = 0; i < Config.Slices; i++)
+    {
+        UINT32 slice = SGPIO_Chain[i];
+        BOOL concat = !(Config.Receive && slice == SGPIO_SLICE_A);
+
+        LPC_SGPIO->SGPIO_MUX_CFG[slice] = ((concat) ? SGPIO_MUX_CONCAT : 0) | SGPIO_MUX_ORDER(order);
+        LPC_SGPIO->SLICE_MUX_CFG[slice] = SGPIO_SLICE_PARALLEL(width);
+        LPC_SGPIO->PRESET[slice] = preset;
+        LPC_SGPIO->COUNT[slice] = preset;
+        LPC_SGPIO->POS[slice] = SGPIO_POS(pos);
+        LPC_SGPIO->REG[slice] = 0;
+        LPC_SGPIO->REG_SS[slice] = 0;
+        s->mask |= 1 << slice;
+    }
+
+    // Clock slice, same counters as the chain
+    LPC_SGPIO->SGPIO_MUX_CFG[SGPIO_SLICE_B] = 0;
+    LPC_SGPIO->SLICE_MUX_CFG[SGPIO_SLICE_B] = (Config.ClockInvert) ? SGPIO_SLICE_INV_CLK : 0;
+    LPC_SGPIO->PRESET[SGPIO_SLICE_B] = preset;
+    LPC_SGPIO->COUNT[SGPIO_SLICE_B] = preset;
+    LPC_SGPIO->POS[SGPIO_SLICE_B] = SGPIO_POS(pos);
+
+    // First two blocks go straight to REG and REG_SS
+    if (!Config.Receive)
+    {
+        SGPIO_Load(Buffer, Config.Slices);
+        for (i = 0; i < Config.Slices; i++)
+        {
+            LPC_SGPIO->REG[SGPIO_Chain[i]] = LPC_SGPIO->REG_SS[SGPIO_Chain[i]];
+        }
+        if (s->blocks > 1) SGPIO_Load(Buffer + n, Config.Slices);
+    }
+    if (s->blocks == 1) LPC_SGPIO->CTRL_DISABLED = s->mask;
+
+    // Pins: data on SGPIO0..Width-1, clock on SGPIO8
+    out = (Config.Width == 8) ? SGPIO_OUT_DOUT8 : (Config.Width == 4) ? SGPIO_OUT_DOUT4 :
+          (Config.Width == 2) ? SGPIO_OUT_DOUT2 : SGPIO_OUT_DOUT1;
+    for (i = 0; i < Config.Width; i++) LPC_SGPIO->OUT_MUX_CFG[i] = out;
+    LPC_SGPIO->OUT_MUX_CFG[SGPIO_CLK_PIN] = SGPIO_OUT_CLK;
+    LPC_SGPIO->GPIO_OENREG = (1 << SGPIO_CLK_PIN) | ((Config.Receive) ? 0 : (1 << Config.Width) - 1);
+    for (i = 0; i < Config.Width; i++)
+    {
+        PIN_Config(SGPIO_Pin[i].pin, SCU_PINIO_FAST | SGPIO_Pin[i].func);
+    }
+    PIN_Config(SGPIO_Pin[SGPIO_CLK_PIN].pin, SCU_PINIO_FAST | SGPIO_Pin[SGPIO_CLK_PIN].func);
+    s->muxed = TRUE;
+
+    if (Status) *Status = SGPIO_PENDING;
+    s->busy = TRUE;
+    LPC_SGPIO->SET_EN_1 = 1 << SGPIO_SLICE_A;
+    LPC_SGPIO->CTRL_ENABLED = s->mask; // All slices start on the same cycle
+    s->last = DWT->CYCCNT;
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+void SGPIO_Stop()
+{
+    GLOBAL_LOCK(irq);
+    if (sgpio.busy) SGPIO_Finish(SGPIO_ERROR);
+}
+
+// ---------------------------------------------------------------------------
+BOOL SGPIO_Busy()
+{
+    return sgpio.busy;
+}
+
+// ---------------------------------------------------------------------------
+void SGPIO_Uninitialize()
+{
+    GLOBAL_LOCK(irq);
+
+    SGPIO_Stop();
+    if (sgpio.init)
+    {
+        CPU_INTC_DeactivateInterrupt(SGPIO_INT_IRQn);
+        sgpio.init = FALSE;
+    }
+    if (sgpio.muxed)
+    {
+        LPC_SGPIO->GPIO_OENREG = 0;
+        for (int i = 0; i < SGPIO_PINS; i++) PIN_Config(SGPIO_Pin[i].pin, SCU_PINIO_PULLDOWN);
+        sgpio.muxed = FALSE;
+    }
+}
@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////////////
+// LPC43XX_SGPIO.h - SGPIO declarations for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _LPC43XX_SGPIO_H_
+#define _LPC43XX_SGPIO_H_
+
+// Parallel serial engine on SGPIO. Width lanes on SGPIO0..Width-1 shift
+// together on one clock, driven out on SGPIO8. A frame is Width bits, lane n
+// is bit n of each frame, frames go out LSB first in little endian words.
+// Slices 32 bit slices are chained, the interrupt that refills or drains
+// them comes once per block of 4 * Slices bytes.
+//
+// A block must last at least 1024 core cycles for the interrupt to keep up,
+// which caps the data rate at 4 * Slices bytes per 1024 cycles: about
+// 6.4 MB/s with 8 slices and 0.8 MB/s with 1 slice at 204 MHz, whatever the
+// lane count. Faster rates would need GPDMA refills.
+
+// Transfer status
+#define SGPIO_PENDING  0
+#define SGPIO_DONE     1
+#define SGPIO_ERROR    2
+
+typedef struct
+{
+  UINT32 Width;     // Lanes: 1, 2, 4 or 8
+  UINT32 Slices;    // Chained slices: 1, 2, 4 or 8
+  UINT32 ClockKHz;  // Shift clock
+  BOOL ClockInvert; // Shift on the falling edge of SGPIO8
+  BOOL Receive;     // Capture the lanes instead of driving them
+} SGPIO_CONFIGURATION;
+
+// Bytes moved per interrupt, transfers are a whole number of blocks
+#define SGPIO_BLOCK_SIZE(slices)  (4 * (slices))
+
+// Starts a transfer of Count bytes and returns without waiting. Buffer must
+// stay valid until Status leaves SGPIO_PENDING, Completion, if not NULL, is
+// enqueued at that point. Fails if a transfer is running, the configuration
+// is invalid, the clock is too fast for the exchange interrupt to keep up
+// with the block size or Count is not a multiple of the block size. Status
+// becomes SGPIO_ERROR if an exchange interrupt is served too late.
+BOOL SGPIO_Transfer(const SGPIO_CONFIGURATION& Config, UINT8* Buffer, UINT32 Count,
+                    volatile INT32* Status, HAL_COMPLETION* Completion);
+// Stops a running transfer, its status becomes SGPIO_ERROR
+void SGPIO_Stop();
+BOOL SGPIO_Busy();
+// Stops the engine and returns the pins to inputs
+void SGPIO_Uninitialize();
+
+#endif // _LPC43XX_SGPIO_H_
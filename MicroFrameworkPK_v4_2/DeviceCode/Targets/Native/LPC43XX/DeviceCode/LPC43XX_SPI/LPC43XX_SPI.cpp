@@ -20,100 +20,809 @@
 #include <tinyhal.h>
 #include "LPC43XX.h"
 #include "LPC43XX_PINS.h"
+#include "..\LPC43XX_GPDMA\LPC43XX_GPDMA.h"
+#include "LPC43XX_SPI.h"
 
-#define TOTAL_SPI_PORT  2
+#define TOTAL_SPI_PORT  3  // SSP0, SSP1, SPI
+#define TOTAL_SSP_PORT  2  // Ports with a FIFO, GPDMA and slave mode
+#define SPI_LEGACY      2  // SPI_mod of the SPI controller
+#define SPI_ROUTES      3  // Pin routes per port
+
+// SPI interrupt handlers
+void SPI_IRQHandler(int spi_mod);
+void SPI0_IRQHandler(void* param);
+void SPI1_IRQHandler(void* param);
+void SPI2_IRQHandler(void* param);
 
 typedef struct
 {
-  LPC_SSP_T *reg;
-  GPIO_PIN msk;
-  GPIO_PIN miso;
-  GPIO_PIN mosi;
+  LPC_SSP_T *reg;    // NULL for the SPI controller
+  IRQn_Type irq;
+  HAL_CALLBACK_FPN isr;
+  UINT32 txReq;
+  UINT32 rxReq;
+  UINT8 route;       // Route selected at initialization
 } SPI_PORT_T;
 
 static SPI_PORT_T const SPI_Port[TOTAL_SPI_PORT] = {
-    {LPC_SSP0, (GPIO_PIN)P3_0, (GPIO_PIN)P1_1, (GPIO_PIN)P1_2},
-    {LPC_SSP1, (GPIO_PIN)PF_4, (GPIO_PIN)P1_3, (GPIO_PIN)P1_4}};
+    {LPC_SSP0, SSP0_IRQn, SPI0_IRQHandler, GPDMA_REQ_SSP0_TX, GPDMA_REQ_SSP0_RX, LPC43XX_SPI0_ROUTE},
+    {LPC_SSP1, SSP1_IRQn, SPI1_IRQHandler, GPDMA_REQ_SSP1_TX, GPDMA_REQ_SSP1_RX, LPC43XX_SPI1_ROUTE},
+    {NULL, SPI_INT_IRQn, SPI2_IRQHandler, GPDMA_REQ_NONE, GPDMA_REQ_NONE, LPC43XX_SPI2_ROUTE}};
+
+// Pin routes. Each pin has its SCU function, SSEL is the slave select input
+// in slave mode. Routes on P3_3..P3_8 share the pads of the SPIFI flash.
+typedef struct
+{
+  GPIO_PIN pin;
+  UINT8 func;
+} SPI_PIN_T;
+
+typedef struct
+{
+  SPI_PIN_T sck;
+  SPI_PIN_T miso;
+  SPI_PIN_T mosi;
+  SPI_PIN_T ssel;
+} SPI_ROUTE_T;
+
+#define SPI_PIN(p, f)    {(GPIO_PIN)(p), (f)}
+#define SPI_NO_ROUTE     {SPI_PIN(GPIO_PIN_NONE, 0), SPI_PIN(GPIO_PIN_NONE, 0), \
+                          SPI_PIN(GPIO_PIN_NONE, 0), SPI_PIN(GPIO_PIN_NONE, 0)}
+
+static SPI_ROUTE_T const SPI_Route[TOTAL_SPI_PORT][SPI_ROUTES] = {
+    {   // SSP0
+        {SPI_PIN(P3_0, 4),  SPI_PIN(P1_1, 5), SPI_PIN(P1_2, 5), SPI_PIN(P1_0, 5)},
+        {SPI_PIN(P3_3, 2),  SPI_PIN(P3_7, 2), SPI_PIN(P3_8, 2), SPI_PIN(P3_6, 2)},
+        {SPI_PIN(PF_0, 0),  SPI_PIN(PF_2, 2), SPI_PIN(PF_3, 2), SPI_PIN(PF_1, 2)}},
+    {   // SSP1
+        {SPI_PIN(PF_4, 0),  SPI_PIN(P1_3, 5), SPI_PIN(P1_4, 5), SPI_PIN(P1_5, 5)},
+        {SPI_PIN(P1_19, 1), SPI_PIN(P0_0, 1), SPI_PIN(P0_1, 1), SPI_PIN(P1_20, 1)},
+        {SPI_PIN(PF_4, 0),  SPI_PIN(PF_6, 2), SPI_PIN(PF_7, 2), SPI_PIN(PF_5, 2)}},
+    {   // SPI
+        {SPI_PIN(P3_3, 1),  SPI_PIN(P3_6, 1), SPI_PIN(P3_7, 1), SPI_PIN(P3_8, 1)},
+        SPI_NO_ROUTE,
+        SPI_NO_ROUTE}};
 
 #define SPI_REG(x)       (SPI_Port[x].reg)
-#define SPI_MSK(x)       (SPI_Port[x].msk)
-#define SPI_MISO(x)      (SPI_Port[x].miso)
-#define SPI_MOSI(x)      (SPI_Port[x].mosi)
+#define SPI_ROUTE(x)     (&SPI_Route[x][spi_bus[x].route])
+#define SPI_IRQ(x)       (SPI_Port[x].irq)
+#define SPI_ISR(x)       (SPI_Port[x].isr)
+#define SPI_TxReq(x)     (SPI_Port[x].txReq)
+#define SPI_RxReq(x)     (SPI_Port[x].rxReq)
+
+// SSP IMSC/ICR (Interrupt Mask/Clear) Flags
+#define SSP_IM_Ror       (1 << 0)  // Receive overrun
+#define SSP_IM_Rt        (1 << 1)  // Receive timeout
+#define SSP_IM_Rx        (1 << 2)  // Receive FIFO half full
+#define SSP_FIFO_DEPTH   8
+// SSP CR1 (Control Register 1) Flags
+#define SSP_CR1_Lbm      (1 << 0)  // Loop back mode
+#define SSP_CR1_Sse      (1 << 1)  // SSP enable
+#define SSP_CR1_Ms       (1 << 2)  // Slave mode
+
+// SPI controller. No FIFO, one frame in flight: SPIF sets when it is done,
+// reading SR then DR clears it.
+#define SPI_CR_BitEnable (1 << 2)  // Frame size from BITS
+#define SPI_CR_Cpha      (1 << 3)
+#define SPI_CR_Cpol      (1 << 4)
+#define SPI_CR_Mstr      (1 << 5)
+#define SPI_CR_Spie      (1 << 7)  // Interrupt on SPIF
+#define SPI_SR_Abrt      (1 << 3)
+#define SPI_SR_Modf      (1 << 4)
+#define SPI_SR_Spif      (1 << 7)
+#define SPI_INT_Flag     (1 << 0)
+#define SPI_CCR_MIN      8         // Even, at least 8
+
+#define SPI_BENCHMARK_FRAMES  512
+
+// Asynchronous transactions. Each port has a queue, the head transaction is
+// running. The TX FIFO is kept primed with no more frames in flight than the
+// RX FIFO holds, the RX half full and timeout interrupts drain it. CS setup
+// and hold times are waited on a HAL completion, so the CPU is free while the
+// chip select settles.
+#define SPI_STATE_IDLE   0
+#define SPI_STATE_SETUP  1  // CS asserted, waiting CS_Setup_uSecs
+#define SPI_STATE_XFER   2  // Frames moving
+#define SPI_STATE_HOLD   3  // Frames done, waiting CS_Hold_uSecs
+
+typedef struct
+{
+  SPI_ASYNC_XACTION* volatile head;  // Polled by SPI_AsyncWait
+  SPI_ASYNC_XACTION* tail;
+  INT32 num;  // Frames in the running transaction
+  INT32 tx;   // Frames written
+  INT32 rx;   // Frames read
+  UINT8 state;
+  HAL_COMPLETION timer;  // CS setup and hold waits
+} SPI_ASYNC_T;
+
+static SPI_ASYNC_T spi_async[TOTAL_SPI_PORT];
+
+// SSP DMACR (DMA Control Register) Flags
+#define SSP_DMA_Rx       (1 << 0)
+#define SSP_DMA_Tx       (1 << 1)
+
+// DMA transfers. Ports in LPC43XX_SPI_DMA_PORTS run transactions of at least
+// LPC43XX_SPI_DMA_THRESHOLD frames on a TX and an RX GPDMA channel. Each
+// direction is a linked list: TX sends the write buffer, then repeats its last
+// frame; RX discards ReadStartOffset frames into a sink word, then fills the
+// read buffer. Completion is the end of the RX list. Blocking transfers poll
+// it for at most twice their shift time plus the slack, in core cycles.
+#define SPI_DMA_WAIT_SLACK  (SystemCoreClock / 100)
+
+typedef struct
+{
+  BOOL dma;        // GPDMA channels allocated
+  UINT8 txCh;
+  UINT8 rxCh;
+  BOOL async;      // Running transaction belongs to the async queue
+} SPI_DMA_T;
+
+static SPI_DMA_T spi_dma[TOTAL_SSP_PORT];
+
+#pragma arm section zidata = "SectionForDMA"
+ALIGNED(4) static GPDMA_LLI_T spi_tx_lli[TOTAL_SSP_PORT][LPC43XX_SPI_DMA_LLI];
+ALIGNED(4) static GPDMA_LLI_T spi_rx_lli[TOTAL_SSP_PORT][LPC43XX_SPI_DMA_LLI];
+ALIGNED(4) static UINT32 spi_dma_sink[TOTAL_SSP_PORT];  // Discarded RX frames
+ALIGNED(4) static UINT32 spi_dma_fill[TOTAL_SSP_PORT];  // Repeated TX frame
+#pragma arm section zidata
+
+// Bus state. Each port caches the register values for recently used
+// configurations and shadows the active ones, so back to back transactions
+// with the same settings skip reconfiguration. Pins stay muxed while the bus
+// is owned, CPU_SPI_Bus_Release returns them to inputs.
+typedef struct
+{
+  UINT32 khz;
+  UINT8 bits;
+  UINT8 mode;
+  UINT32 cr0;
+  UINT32 cpsr;
+} SPI_CFG_T;
+
+typedef struct
+{
+  SPI_CFG_T cache[LPC43XX_SPI_CONFIG_CACHE];
+  UINT8 next;    // Next cache entry to replace
+  UINT32 cr0;    // Active register values, 0 if not configured
+  UINT32 cr1;
+  UINT32 cpsr;
+  BOOL muxed;    // Pins assigned to the controller
+  BOOL idle;     // SCK idles high
+  UINT8 route;   // Index in SPI_Route
+} SPI_BUS_T;
+
+static SPI_BUS_T spi_bus[TOTAL_SPI_PORT];
+
+// Slave mode. The host clocks a continuous byte stream: RX runs a circular
+// GPDMA list into spi_slave_rx, TX a circular list out of spi_slave_tx, both
+// on the port's DMA channels and list items. A pin interrupt on SSEL marks
+// frame boundaries and reports the frame length. Received data stays in the
+// ring until consumed, the oldest segment is dropped on overflow. Sent TX
+// bytes are overwritten with SPI_SLAVE_FILL, so an underrun sends fill
+// instead of stale data.
+#define SPI_SLAVE_SEGMENTS    4
+#define SPI_SLAVE_RX_SEGSIZE  (LPC43XX_SPI_SLAVE_RX_SIZE / SPI_SLAVE_SEGMENTS)
+#define SPI_SLAVE_TX_SEGSIZE  (LPC43XX_SPI_SLAVE_TX_SIZE / SPI_SLAVE_SEGMENTS)
+#define SPI_SLAVE_FILL        0xFF
+
+#if LPC43XX_SPI_DMA_LLI < SPI_SLAVE_SEGMENTS
+#error LPC43XX_SPI_DMA_LLI must hold the slave ring segments
+#endif
+
+typedef struct
+{
+  BOOL active;
+  SPI_SLAVE_FRAME_FPN frame;
+  void* param;
+  UINT32 rxTail;    // Next byte to consume
+  UINT32 rxFrame;   // Start of the frame in progress
+  UINT32 txHead;    // Next byte to queue
+  UINT32 txPos;     // DMA read position at the last sync
+  UINT32 txQueued;  // Bytes queued and not yet sent
+  UINT32 overruns;
+} SPI_SLAVE_T;
+
+static SPI_SLAVE_T spi_slave[TOTAL_SSP_PORT];
+
+#define SPI_SLAVE_ACTIVE(x)  ((x) < TOTAL_SSP_PORT && spi_slave[x].active)
+
+#pragma arm section zidata = "SectionForDMA"
+ALIGNED(4) static UINT8 spi_slave_rx[TOTAL_SSP_PORT][LPC43XX_SPI_SLAVE_RX_SIZE];
+ALIGNED(4) static UINT8 spi_slave_tx[TOTAL_SSP_PORT][LPC43XX_SPI_SLAVE_TX_SIZE];
+#pragma arm section zidata
 
 // Local functions
-static BOOL SPI_Config(LPC_SSP_T *spi, int Bits, int Mode, int Slave);
-static BOOL SPI_Frequency(LPC_SSP_T *spi, int Hz);
+static BOOL SPI_Divisor(UINT32 Hz, UINT32& cpsr, UINT32& scr);
+static BOOL SPI_LegacyDivisor(UINT32 Hz, UINT32& ccr);
+static BOOL SPI_Setup(int spi_mod, int Bits, int Mode, UINT32 KHz, BOOL Slave);
 static inline int SPI_Enable(LPC_SSP_T *spi);
 static inline int SPI_Disable(LPC_SSP_T *spi);
 static inline int SPI_Read(LPC_SSP_T *spi);
 static inline void SPI_Write(LPC_SSP_T *spi, int value);
 static inline int SPI_Readable(LPC_SSP_T *spi);
 static inline int SPI_Busy(LPC_SSP_T *spi);
+static void SPI_Fifo8(LPC_SSP_T *spi, UINT8* outBuf, INT32 outLen,
+                      UINT8* inBuf, INT32 inLen, INT32 inOffset);
+static void SPI_Fifo16(LPC_SSP_T *spi, UINT16* outBuf, INT32 outLen,
+                       UINT16* inBuf, INT32 inLen, INT32 inOffset);
+static void SPI_Legacy(BOOL wide, void* outBuf, INT32 outLen,
+                       void* inBuf, INT32 inLen, INT32 inOffset);
+static BOOL SPI_AsyncValid(SPI_ASYNC_XACTION* Xaction);
+static void SPI_AsyncQueue(SPI_ASYNC_XACTION* first, SPI_ASYNC_XACTION* last);
+static BOOL SPI_AsyncWait(UINT32 spi_mod, SmartPtr_IRQ& irq);
+static void SPI_AsyncStart(int spi_mod);
+static void SPI_AsyncXfer(int spi_mod);
+static void SPI_AsyncPump(int spi_mod);
+static void SPI_AsyncFrame(int spi_mod);
+static void SPI_AsyncStop(int spi_mod, INT32 Status);
+static void SPI_AsyncFinish(int spi_mod, INT32 Status);
+static void SPI_AsyncTimer(void* arg);
+static BOOL SPI_DmaAppend(GPDMA_LLI_T* lli, int& n, UINT32 src, UINT32 dst,
+                          UINT32 ctrl, UINT32 count, int width);
+static BOOL SPI_DmaStart(int spi_mod, BOOL wide, void* Write, INT32 WriteCount,
+                         void* Read, INT32 ReadCount, INT32 ReadStartOffset, BOOL async);
+static void SPI_DmaStop(int spi_mod);
+static BOOL SPI_DmaWait(int spi_mod, INT32 num);
+static void SPI_DmaHandler(void* param, UINT32 status);
+static UINT32 SPI_SlaveRxHead(int spi_mod);
+static void SPI_SlaveTxSync(int spi_mod);
+static void SPI_SlaveDmaHandler(int spi_mod);
+static void SPI_SlaveSsel(GPIO_PIN Pin, BOOL PinState, void* Param);
 
-static BOOL SPI_Config(LPC_SSP_T *spi, int Bits, int Mode, int Slave)
+// ---------------------------------------------------------------------------
+void SPI_IRQHandler(int spi_mod)
 {
-    SPI_Disable(spi);
-    
-    if (!(Bits >= 4 && Bits <= 16) || !(Mode >= 0 && Mode <= 3)) {
-        return FALSE; // SPI format error
+    LPC_SSP_T *spi = SPI_REG(spi_mod);
+    SPI_ASYNC_T *as = &spi_async[spi_mod];
+
+    spi->ICR = SSP_IM_Ror | SSP_IM_Rt;
+    if (as->head == NULL || as->state != SPI_STATE_XFER)
+    {
+        spi->IMSC = 0; // Spurious, nothing running
+        return;
+    }
+
+    SPI_AsyncPump(spi_mod);
+    if (as->rx >= as->num) SPI_AsyncStop(spi_mod, SPI_ASYNC_DONE);
+}
+
+void SPI0_IRQHandler(void* param) { SPI_IRQHandler(0); }
+void SPI1_IRQHandler(void* param) { SPI_IRQHandler(1); }
+
+// ---------------------------------------------------------------------------
+// SPI controller, one interrupt per frame
+void SPI2_IRQHandler(void* param)
+{
+    SPI_ASYNC_T *as = &spi_async[SPI_LEGACY];
+    UINT32 sr = LPC_SPI->SR;
+    UINT32 in = LPC_SPI->DR; // Clears SPIF
+
+    LPC_SPI->INT = SPI_INT_Flag;
+    if (as->head == NULL || as->state != SPI_STATE_XFER)
+    {
+        LPC_SPI->CR &= ~SPI_CR_Spie; // Spurious, nothing running
+        return;
+    }
+    if (sr & (SPI_SR_Abrt | SPI_SR_Modf))
+    {
+        SPI_AsyncStop(SPI_LEGACY, SPI_ASYNC_ERROR);
+        return;
+    }
+    if (!(sr & SPI_SR_Spif)) return;
+
+    SPI_ASYNC_XACTION *x = as->head;
+    INT32 i = as->rx++ - ((x->ReadCount) ? x->ReadStartOffset : as->num);
+    if (i >= 0 && i < x->ReadCount)
+    {
+        if (x->Configuration.MD_16bits) ((UINT16*)x->Read)[i] = (UINT16)in;
+        else ((UINT8*)x->Read)[i] = (UINT8)in;
+    }
+
+    if (as->rx >= as->num) SPI_AsyncStop(SPI_LEGACY, SPI_ASYNC_DONE);
+    else SPI_AsyncFrame(SPI_LEGACY);
+}
+
+// ---------------------------------------------------------------------------
+// Starts the transaction at the head of the queue. Called with interrupts
+// disabled or from the SSP, GPDMA or timer ISRs.
+static void SPI_AsyncStart(int spi_mod)
+{
+    SPI_ASYNC_T *as = &spi_async[spi_mod];
+    const SPI_CONFIGURATION& cfg = as->head->Configuration;
+    int Bits, Mode;
+
+    Bits = (cfg.MD_16bits) ? 16 : 8;
+    Mode = (cfg.MSK_IDLE) ? 2 : 0;
+    Mode |= (!cfg.MSK_SampleEdge) ? 1 : 0;
+    if (!SPI_Setup(spi_mod, Bits, Mode, cfg.Clock_RateKHz, FALSE))
+    {
+        SPI_AsyncFinish(spi_mod, SPI_ASYNC_ERROR);
+        return;
+    }
+
+    CPU_GPIO_EnableOutputPin(cfg.DeviceCS, cfg.CS_Active);
+    if (cfg.CS_Setup_uSecs)
+    {
+        as->state = SPI_STATE_SETUP;
+        as->timer.EnqueueDelta(cfg.CS_Setup_uSecs);
+        return;
+    }
+    SPI_AsyncXfer(spi_mod);
+}
+
+// ---------------------------------------------------------------------------
+// Moves the frames of the head transaction, on GPDMA or the port interrupt
+static void SPI_AsyncXfer(int spi_mod)
+{
+    LPC_SSP_T *spi = SPI_REG(spi_mod);
+    SPI_ASYNC_T *as = &spi_async[spi_mod];
+    SPI_ASYNC_XACTION *x = as->head;
+
+    as->state = SPI_STATE_XFER;
+    as->num = (x->ReadCount) ? x->ReadCount + x->ReadStartOffset : x->WriteCount;
+    as->tx = 0;
+    as->rx = 0;
+
+    if (spi_mod == SPI_LEGACY)
+    {
+        LPC_SPI->CR |= SPI_CR_Spie;
+        SPI_AsyncFrame(spi_mod);
+        return;
+    }
+
+    if (SPI_DmaStart(spi_mod, x->Configuration.MD_16bits, x->Write, x->WriteCount,
+                     x->Read, x->ReadCount, x->ReadStartOffset, TRUE)) return;
+
+    spi->ICR = SSP_IM_Ror | SSP_IM_Rt;
+    SPI_AsyncPump(spi_mod);
+    spi->IMSC = SSP_IM_Rt | SSP_IM_Rx;
+}
+
+// ---------------------------------------------------------------------------
+// Drains the RX FIFO and refills the TX FIFO
+static void SPI_AsyncPump(int spi_mod)
+{
+    LPC_SSP_T *spi = SPI_REG(spi_mod);
+    SPI_ASYNC_T *as = &spi_async[spi_mod];
+    SPI_ASYNC_XACTION *x = as->head;
+    BOOL wide = x->Configuration.MD_16bits;
+    INT32 skip = (x->ReadCount) ? x->ReadStartOffset : as->num;
+    INT32 i;
+
+    while (SPI_Readable(spi))
+    {
+        int in = SPI_Read(spi);
+        i = as->rx++ - skip;
+        if (i >= 0 && i < x->ReadCount)
+        {
+            if (wide) ((UINT16*)x->Read)[i] = (UINT16)in;
+            else ((UINT8*)x->Read)[i] = (UINT8)in;
+        }
+    }
+
+    while (as->tx < as->num && as->tx - as->rx < SSP_FIFO_DEPTH)
+    {
+        // Past the write buffer the last frame is repeated
+        i = (as->tx < x->WriteCount) ? as->tx : x->WriteCount - 1;
+        if (i < 0) SPI_Write(spi, 0);
+        else if (wide) SPI_Write(spi, ((UINT16*)x->Write)[i]);
+        else SPI_Write(spi, ((UINT8*)x->Write)[i]);
+        as->tx++;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Writes the next frame on the SPI controller. Past the write buffer the
+// last frame is repeated.
+static void SPI_AsyncFrame(int spi_mod)
+{
+    SPI_ASYNC_T *as = &spi_async[spi_mod];
+    SPI_ASYNC_XACTION *x = as->head;
+    INT32 i = (as->tx < x->WriteCount) ? as->tx : x->WriteCount - 1;
+
+    if (i < 0) LPC_SPI->DR = 0;
+    else if (x->Configuration.MD_16bits) LPC_SPI->DR = ((UINT16*)x->Write)[i];
+    else LPC_SPI->DR = ((UINT8*)x->Write)[i];
+    as->tx++;
+}
+
+// ---------------------------------------------------------------------------
+// Ends the frames of the head transaction, then waits the CS hold time
+static void SPI_AsyncStop(int spi_mod, INT32 Status)
+{
+    LPC_SSP_T *spi = SPI_REG(spi_mod);
+    SPI_ASYNC_T *as = &spi_async[spi_mod];
+    UINT32 hold = as->head->Configuration.CS_Hold_uSecs;
+
+    if (spi_mod == SPI_LEGACY)
+    {
+        LPC_SPI->CR &= ~SPI_CR_Spie; // Frames end with SPIF, nothing in flight
+    } else {
+        spi->IMSC = 0;
+        SPI_DmaStop(spi_mod);
+        while (SPI_Busy(spi)); // Last frame out
+    }
+
+    if (Status == SPI_ASYNC_DONE && hold)
+    {
+        as->state = SPI_STATE_HOLD;
+        as->timer.EnqueueDelta(hold);
+        return;
+    }
+    SPI_AsyncFinish(spi_mod, Status);
+}
+
+// ---------------------------------------------------------------------------
+// Releases CS, completes the head transaction and starts the next one
+static void SPI_AsyncFinish(int spi_mod, INT32 Status)
+{
+    SPI_ASYNC_T *as = &spi_async[spi_mod];
+    SPI_ASYNC_XACTION *x = as->head;
+
+    CPU_GPIO_SetPinState(x->Configuration.DeviceCS, !x->Configuration.CS_Active);
+    as->state = SPI_STATE_IDLE;
+
+    as->head = x->Next;
+    if (as->head == NULL) as->tail = NULL;
+    x->Next = NULL;
+    x->Status = Status;
+    if (x->Completion) x->Completion->EnqueueDelta(0);
+
+    if (as->head) SPI_AsyncStart(spi_mod);
+}
+
+// ---------------------------------------------------------------------------
+// CS setup or hold time elapsed
+static void SPI_AsyncTimer(void* arg)
+{
+    int spi_mod = (int)arg;
+    SPI_ASYNC_T *as = &spi_async[spi_mod];
+
+    GLOBAL_LOCK(irq);
+    if (as->head == NULL) return;
+    if (as->state == SPI_STATE_SETUP) SPI_AsyncXfer(spi_mod);
+    else if (as->state == SPI_STATE_HOLD) SPI_AsyncFinish(spi_mod, SPI_ASYNC_DONE);
+}
+
+// ---------------------------------------------------------------------------
+// Appends items for count frames to a linked list, split at the GPDMA
+// transfer size limit. Addresses advance only where ctrl increments them.
+static BOOL SPI_DmaAppend(GPDMA_LLI_T* lli, int& n, UINT32 src, UINT32 dst,
+                          UINT32 ctrl, UINT32 count, int width)
+{
+    while (count)
+    {
+        UINT32 len = (count > GPDMA_MAX_SIZE) ? GPDMA_MAX_SIZE : count;
+
+        if (n >= LPC43XX_SPI_DMA_LLI) return FALSE; // List too long
+        lli[n].src = src;
+        lli[n].dst = dst;
+        lli[n].lli = 0;
+        lli[n].ctrl = ctrl | GPDMA_CTRL_SIZE(len);
+        if (n) lli[n - 1].lli = (UINT32)&lli[n];
+        n++;
+
+        if (ctrl & GPDMA_CTRL_SRC_INC) src += len << width;
+        if (ctrl & GPDMA_CTRL_DST_INC) dst += len << width;
+        count -= len;
+    }
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Starts a full duplex GPDMA transfer. Returns FALSE without touching the
+// SSP if the port has no DMA, the transaction is under the threshold or the
+// lists do not fit, so the caller falls back to the FIFO engine.
+static BOOL SPI_DmaStart(int spi_mod, BOOL wide, void* Write, INT32 WriteCount,
+                         void* Read, INT32 ReadCount, INT32 ReadStartOffset, BOOL async)
+{
+    if (spi_mod >= TOTAL_SSP_PORT) return FALSE;
+
+    SPI_DMA_T *dma = &spi_dma[spi_mod];
+    LPC_SSP_T *spi = SPI_REG(spi_mod);
+    GPDMA_LLI_T *tx = spi_tx_lli[spi_mod];
+    GPDMA_LLI_T *rx = spi_rx_lli[spi_mod];
+    INT32 num = (ReadCount) ? ReadCount + ReadStartOffset : WriteCount;
+    INT32 out = (WriteCount < num) ? WriteCount : num;
+    int width = (wide) ? GPDMA_WIDTH_HALFWORD : GPDMA_WIDTH_BYTE;
+    int ntx = 0, nrx = 0;
+    UINT32 ctrl;
+
+    if (!dma->dma || num < LPC43XX_SPI_DMA_THRESHOLD) return FALSE;
+
+    // Frame sent once the write buffer runs out
+    spi_dma_fill[spi_mod] = 0;
+    if (WriteCount > 0)
+    {
+        if (wide) spi_dma_fill[spi_mod] = ((UINT16*)Write)[WriteCount - 1];
+        else spi_dma_fill[spi_mod] = ((UINT8*)Write)[WriteCount - 1];
+    }
+
+    ctrl = GPDMA_CTRL_SBSIZE(GPDMA_BURST_1) | GPDMA_CTRL_DBSIZE(GPDMA_BURST_1)
+           | GPDMA_CTRL_SWIDTH(width) | GPDMA_CTRL_DWIDTH(width) | GPDMA_CTRL_DST_AHB1;
+    if (!SPI_DmaAppend(tx, ntx, (UINT32)Write, (UINT32)&spi->DR, ctrl | GPDMA_CTRL_SRC_INC, out, width)
+        || !SPI_DmaAppend(tx, ntx, (UINT32)&spi_dma_fill[spi_mod], (UINT32)&spi->DR, ctrl, num - out, width))
+        return FALSE;
+
+    ctrl = GPDMA_CTRL_SBSIZE(GPDMA_BURST_1) | GPDMA_CTRL_DBSIZE(GPDMA_BURST_1)
+           | GPDMA_CTRL_SWIDTH(width) | GPDMA_CTRL_DWIDTH(width) | GPDMA_CTRL_SRC_AHB1;
+    if (!SPI_DmaAppend(rx, nrx, (UINT32)&spi->DR, (UINT32)&spi_dma_sink[spi_mod], ctrl, num - ReadCount, width)
+        || !SPI_DmaAppend(rx, nrx, (UINT32)&spi->DR, (UINT32)Read, ctrl | GPDMA_CTRL_DST_INC, ReadCount, width))
+        return FALSE;
+    if (async) rx[nrx - 1].ctrl |= GPDMA_CTRL_TC_IRQ;
+
+    while (SPI_Readable(spi)) SPI_Read(spi); // Discard stale frames
+
+    // Receive first, so the RX channel is armed before frames come back
+    dma->async = async;
+    if (!GPDMA_Transfer(dma->rxCh, rx[0].src, rx[0].dst, rx[0].ctrl, SPI_RxReq(spi_mod),
+                        GPDMA_CFG_P2M, (GPDMA_LLI_T*)rx[0].lli)
+        || !GPDMA_Transfer(dma->txCh, tx[0].src, tx[0].dst, tx[0].ctrl, SPI_TxReq(spi_mod),
+                           GPDMA_CFG_M2P, (GPDMA_LLI_T*)tx[0].lli))
+    {
+        SPI_DmaStop(spi_mod); // Channel busy, the FIFO engine takes over
+        return FALSE;
     }
-    
-    int polarity = (Mode & 0x2) ? 1 : 0;
-    int phase = (Mode & 0x1) ? 1 : 0;
-    
-    // set it up
-    int DSS = Bits - 1;            // DSS (data select size)
-    int SPO = (polarity) ? 1 : 0;  // SPO - clock out polarity
-    int SPH = (phase) ? 1 : 0;     // SPH - clock out phase
-    
-    int FRF = 0;                   // FRF (frame format) = SPI
-    uint32_t tmp = spi->CR0;
-    tmp &= ~(0xFFFF);
-    tmp |= DSS << 0
-        | FRF << 4
-        | SPO << 6
-        | SPH << 7;
-    spi->CR0 = tmp;
-    
-    tmp = spi->CR1;
-    tmp &= ~(0xD);
-    tmp |= 0 << 0                  // LBM - loop back mode - off
-        | ((Slave) ? 1 : 0) << 2   // MS  - master Slave mode, 1 = Slave
-        | 0 << 3;                  // SOD - slave output disable - na
-    spi->CR1 = tmp;
-    SPI_Enable(spi);
+    spi->DMACR = SSP_DMA_Rx | SSP_DMA_Tx;
     return TRUE;
 }
 
-static BOOL SPI_Frequency(LPC_SSP_T *spi, int Hz)
-{
-    SPI_Disable(spi);
-    
-    uint32_t PCLK = SystemCoreClock;
-    
-    int prescaler;
-    
-    for (prescaler = 2; prescaler <= 254; prescaler += 2) {
-        int prescale_Hz = PCLK / prescaler;
-        
-        // calculate the divider
-        int divider = floor(((float)prescale_Hz / (float)Hz) + 0.5f);
-        
-        // check we can support the divider
-        if (divider < 256) {
-            // prescaler
-            spi->CPSR = prescaler;
-            
-            // divider
-            spi->CR0 &= ~(0xFFFF << 8);
-            spi->CR0 |= (divider - 1) << 8;
-            SPI_Enable(spi);
+// ---------------------------------------------------------------------------
+static void SPI_DmaStop(int spi_mod)
+{
+    if (spi_mod >= TOTAL_SSP_PORT) return;
+
+    SPI_DMA_T *dma = &spi_dma[spi_mod];
+
+    if (!dma->dma) return;
+    SPI_REG(spi_mod)->DMACR = 0;
+    GPDMA_Stop(dma->txCh);
+    GPDMA_Stop(dma->rxCh);
+    dma->async = FALSE;
+}
+
+// ---------------------------------------------------------------------------
+// Polls a blocking transfer of num frames with interrupts disabled. Gives up
+// at twice the shift time plus SPI_DMA_WAIT_SLACK. Returns FALSE on a timeout
+// or a GPDMA error on either channel, the caller then stops the channels.
+static BOOL SPI_DmaWait(int spi_mod, INT32 num)
+{
+    LPC_SSP_T *spi = SPI_REG(spi_mod);
+    SPI_DMA_T *dma = &spi_dma[spi_mod];
+    // PCLK is the core clock, CPSR * (SCR + 1) cycles per bit
+    UINT64 limit = (UINT64)2 * num * ((spi->CR0 & 0xF) + 1) * (spi->CPSR & 0xFF)
+                   * (((spi->CR0 >> 8) & 0xFF) + 1) + SPI_DMA_WAIT_SLACK;
+    UINT64 elapsed = 0;
+    UINT32 last, now;
+
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    last = DWT->CYCCNT;
+    while (GPDMA_Busy(dma->rxCh))
+    {
+        if (GPDMA_Error(dma->rxCh) || GPDMA_Error(dma->txCh)) return FALSE;
+        now = DWT->CYCCNT;
+        elapsed += now - last;  // Accumulated, CYCCNT wraps in about 21 s
+        last = now;
+        if (elapsed > limit) return FALSE;
+    }
+    return (GPDMA_Error(dma->rxCh) || GPDMA_Error(dma->txCh)) ? FALSE : TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// End of the RX list, only its last item raises terminal count, or an
+// error on either channel
+static void SPI_DmaHandler(void* param, UINT32 status)
+{
+    int spi_mod = (int)param;
+
+    if (spi_slave[spi_mod].active) { SPI_SlaveDmaHandler(spi_mod); return; }
+    if (!spi_dma[spi_mod].async) return; // Polled by the blocking path
+    SPI_AsyncStop(spi_mod, (status & GPDMA_STATUS_ERR) ? SPI_ASYNC_ERROR : SPI_ASYNC_DONE);
+}
+
+// ---------------------------------------------------------------------------
+// Index in the RX ring where the DMA writes the next byte
+static UINT32 SPI_SlaveRxHead(int spi_mod)
+{
+    UINT32 head = GPDMA_DestAddress(spi_dma[spi_mod].rxCh) - (UINT32)spi_slave_rx[spi_mod];
+    return (head >= LPC43XX_SPI_SLAVE_RX_SIZE) ? 0 : head;
+}
+
+// ---------------------------------------------------------------------------
+// Accounts for the TX bytes the DMA has read since the last call and fills
+// them. Must run at least once per ring lap, the segment interrupts ensure it.
+static void SPI_SlaveTxSync(int spi_mod)
+{
+    SPI_SLAVE_T *sl = &spi_slave[spi_mod];
+    UINT8 *buf = spi_slave_tx[spi_mod];
+    UINT32 pos = GPDMA_SrcAddress(spi_dma[spi_mod].txCh) - (UINT32)buf;
+    UINT32 sent;
+
+    if (pos >= LPC43XX_SPI_SLAVE_TX_SIZE) pos = 0;
+    sent = (pos + LPC43XX_SPI_SLAVE_TX_SIZE - sl->txPos) % LPC43XX_SPI_SLAVE_TX_SIZE;
+
+    while (sl->txPos != pos)
+    {
+        buf[sl->txPos] = SPI_SLAVE_FILL;
+        if (++sl->txPos >= LPC43XX_SPI_SLAVE_TX_SIZE) sl->txPos = 0;
+    }
+    if (sl->txQueued > sent) {
+        sl->txQueued -= sent;
+    } else {
+        sl->txQueued = 0; // Underrun, queue again from the DMA position
+        sl->txHead = pos;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// End of a ring segment on either channel
+static void SPI_SlaveDmaHandler(int spi_mod)
+{
+    SPI_SLAVE_T *sl = &spi_slave[spi_mod];
+    UINT32 head = SPI_SlaveRxHead(spi_mod);
+    UINT32 used = (head + LPC43XX_SPI_SLAVE_RX_SIZE - sl->rxTail) % LPC43XX_SPI_SLAVE_RX_SIZE;
+
+    // Keep a free segment ahead of the DMA, drop the oldest data
+    if (used > LPC43XX_SPI_SLAVE_RX_SIZE - SPI_SLAVE_RX_SEGSIZE)
+    {
+        UINT32 tail = (head - head % SPI_SLAVE_RX_SEGSIZE + SPI_SLAVE_RX_SEGSIZE)
+                      % LPC43XX_SPI_SLAVE_RX_SIZE;
+        UINT32 lost = (tail + LPC43XX_SPI_SLAVE_RX_SIZE - sl->rxTail) % LPC43XX_SPI_SLAVE_RX_SIZE;
+        UINT32 frame = (sl->rxFrame + LPC43XX_SPI_SLAVE_RX_SIZE - sl->rxTail) % LPC43XX_SPI_SLAVE_RX_SIZE;
+
+        if (frame < lost) sl->rxFrame = tail;
+        sl->rxTail = tail;
+        sl->overruns++;
+    }
+    SPI_SlaveTxSync(spi_mod);
+}
+
+// ---------------------------------------------------------------------------
+// SSEL deasserted, the host ended a frame
+static void SPI_SlaveSsel(GPIO_PIN Pin, BOOL PinState, void* Param)
+{
+    int spi_mod = (int)Param;
+    SPI_SLAVE_T *sl = &spi_slave[spi_mod];
+    LPC_SSP_T *spi = SPI_REG(spi_mod);
+    UINT32 head, len;
+
+    if (!sl->active) return;
+
+    // Let the DMA drain the RX FIFO, at most a FIFO worth of requests
+    for (int i = 0; i < 16 * SSP_FIFO_DEPTH && SPI_Readable(spi); i++);
+
+    head = SPI_SlaveRxHead(spi_mod);
+    len = (head + LPC43XX_SPI_SLAVE_RX_SIZE - sl->rxFrame) % LPC43XX_SPI_SLAVE_RX_SIZE;
+    sl->rxFrame = head;
+    SPI_SlaveTxSync(spi_mod);
+
+    if (len && sl->frame) sl->frame(sl->param, len, sl->overruns);
+}
+
+// ---------------------------------------------------------------------------
+// Finds the first even prescaler (2..254) for which the rounded SCR divider
+// fits, same result as the original float search.
+static BOOL SPI_Divisor(UINT32 Hz, UINT32& cpsr, UINT32& scr)
+{
+    UINT32 PCLK = SystemCoreClock;
+
+    if (Hz == 0) return FALSE;
+    for (UINT32 prescaler = 2; prescaler <= 254; prescaler += 2)
+    {
+        UINT32 prescale_Hz = PCLK / prescaler;
+        UINT32 divider = (prescale_Hz + Hz / 2) / Hz; // Rounded
+
+        if (divider < 256)
+        {
+            cpsr = prescaler;
+            scr = (divider) ? divider - 1 : 0;
             return TRUE;
         }
     }
     return FALSE; // Couldn't setup requested SPI frequency
 }
 
+// ---------------------------------------------------------------------------
+// SPI controller clock is PCLK / CCR, CCR even and at least 8. Rounds the
+// divider up so SCK does not exceed the requested rate.
+static BOOL SPI_LegacyDivisor(UINT32 Hz, UINT32& ccr)
+{
+    if (Hz == 0) return FALSE;
+    ccr = (SystemCoreClock + Hz - 1) / Hz;
+    ccr = (ccr + 1) & ~1;
+    if (ccr < SPI_CCR_MIN) ccr = SPI_CCR_MIN;
+    return (ccr <= 254) ? TRUE : FALSE;
+}
+
+// ---------------------------------------------------------------------------
+// Selects a configuration on a port. Register values are looked up in the
+// port cache, and CR0/CR1/CPSR are written only if they differ from the
+// active ones. The SPI controller keeps its CR in cr0 and CCR in cpsr. Pins
+// of the selected route are muxed on first use and stay muxed until the bus
+// is released.
+static BOOL SPI_Setup(int spi_mod, int Bits, int Mode, UINT32 KHz, BOOL Slave)
+{
+    LPC_SSP_T *spi = SPI_REG(spi_mod);
+    SPI_BUS_T *bus = &spi_bus[spi_mod];
+    const SPI_ROUTE_T *route = SPI_ROUTE(spi_mod);
+    SPI_CFG_T *cfg = NULL;
+    UINT32 cr1;
+
+    if (!(Bits >= 4 && Bits <= 16) || !(Mode >= 0 && Mode <= 3)) {
+        return FALSE; // SPI format error
+    }
+    if (spi_mod == SPI_LEGACY && (Bits < 8 || Slave)) return FALSE;
+
+    for (int i = 0; i < LPC43XX_SPI_CONFIG_CACHE; i++)
+    {
+        SPI_CFG_T *c = &bus->cache[i];
+        if (c->khz == KHz && c->bits == Bits && c->mode == Mode) { cfg = c; break; }
+    }
+    if (cfg == NULL) // Miss, compute and replace round robin
+    {
+        UINT32 cpsr, scr, cr0;
+        if (spi_mod == SPI_LEGACY)
+        {
+            if (!SPI_LegacyDivisor(1000 * KHz, cpsr)) return FALSE;
+            cr0 = SPI_CR_BitEnable | SPI_CR_Mstr
+                  | (Bits & 0xF) << 8            // BITS - 0 is 16 bits
+                  | ((Mode & 1) ? SPI_CR_Cpha : 0)
+                  | ((Mode & 2) ? SPI_CR_Cpol : 0);
+        } else {
+            if (!SPI_Divisor(1000 * KHz, cpsr, scr)) return FALSE;
+            cr0 = (Bits - 1) << 0                // DSS - data size
+                  | 0 << 4                       // FRF - frame format = SPI
+                  | ((Mode >> 1) & 1) << 6       // SPO - clock out polarity
+                  | (Mode & 1) << 7              // SPH - clock out phase
+                  | scr << 8;                    // SCR - serial clock rate
+        }
+
+        cfg = &bus->cache[bus->next];
+        bus->next = (bus->next + 1) % LPC43XX_SPI_CONFIG_CACHE;
+        cfg->khz = KHz;
+        cfg->bits = Bits;
+        cfg->mode = Mode;
+        cfg->cpsr = cpsr;
+        cfg->cr0 = cr0;
+    }
+
+    cr1 = ((Slave) ? SSP_CR1_Ms : 0) | SSP_CR1_Sse;
+    if (spi_mod == SPI_LEGACY)
+    {
+        if (bus->cr0 != cfg->cr0 || bus->cpsr != cfg->cpsr)
+        {
+            LPC_SPI->CCR = cfg->cpsr;
+            LPC_SPI->CR = cfg->cr0;
+            bus->cr0 = cfg->cr0;
+            bus->cpsr = cfg->cpsr;
+        }
+    }
+    else if (bus->cr0 != cfg->cr0 || bus->cpsr != cfg->cpsr || bus->cr1 != cr1)
+    {
+        SPI_Disable(spi);
+        spi->CR0 = cfg->cr0;
+        spi->CPSR = cfg->cpsr;
+        spi->CR1 = cr1 & ~SSP_CR1_Sse;
+        SPI_Enable(spi);
+        bus->cr0 = cfg->cr0;
+        bus->cpsr = cfg->cpsr;
+        bus->cr1 = cr1;
+    }
+
+    if (!bus->muxed)
+    {
+        PIN_Config(route->sck.pin,  SCU_PINIO_FAST | route->sck.func);
+        PIN_Config(route->miso.pin, SCU_PINIO_FAST | route->miso.func);
+        PIN_Config(route->mosi.pin, SCU_PINIO_FAST | route->mosi.func);
+        // A master SPI controller faults if its SSEL input goes low
+        if (spi_mod == SPI_LEGACY) PIN_Config(route->ssel.pin, SCU_PINIO_PULLUP | route->ssel.func);
+        bus->muxed = TRUE;
+    }
+    bus->idle = (Mode & 2) ? TRUE : FALSE;
+    return TRUE;
+}
+
 static inline int SPI_Enable(LPC_SSP_T *spi)
 {
     return spi->CR1 |= (1 << 1);
@@ -145,19 +854,276 @@ static inline int SPI_Busy(LPC_SSP_T *spi)
     return (spi->SR & (1 << 4)) ? (1) : (0);
 }
 
+// Polled FIFO engine. The TX FIFO is kept primed while RX drains, with no
+// more frames in flight than the RX FIFO holds, so SCK runs without gaps
+// between frames. Past the write buffer the last frame is repeated. Frames
+// before inOffset are discarded, inLen = 0 discards all of them.
+static void SPI_Fifo8(LPC_SSP_T *spi, UINT8* outBuf, INT32 outLen,
+                      UINT8* inBuf, INT32 inLen, INT32 inOffset)
+{
+    INT32 num = (inLen) ? inLen + inOffset : outLen;
+    INT32 tx = 0, rx = 0, i;
+    UINT8 out = 0;
+
+    while (rx < num)
+    {
+        while (tx < num && tx - rx < SSP_FIFO_DEPTH) // Fill TX FIFO
+        {
+            if (tx < outLen) out = outBuf[tx];
+            SPI_Write(spi, out);
+            tx++;
+        }
+        while (SPI_Readable(spi)) // Drain RX FIFO
+        {
+            i = rx++ - inOffset;
+            if ((UINT32)i < (UINT32)inLen) inBuf[i] = (UINT8)SPI_Read(spi);
+            else SPI_Read(spi);
+        }
+    }
+}
+
+static void SPI_Fifo16(LPC_SSP_T *spi, UINT16* outBuf, INT32 outLen,
+                       UINT16* inBuf, INT32 inLen, INT32 inOffset)
+{
+    INT32 num = (inLen) ? inLen + inOffset : outLen;
+    INT32 tx = 0, rx = 0, i;
+    UINT16 out = 0;
+
+    while (rx < num)
+    {
+        while (tx < num && tx - rx < SSP_FIFO_DEPTH) // Fill TX FIFO
+        {
+            if (tx < outLen) out = outBuf[tx];
+            SPI_Write(spi, out);
+            tx++;
+        }
+        while (SPI_Readable(spi)) // Drain RX FIFO
+        {
+            i = rx++ - inOffset;
+            if ((UINT32)i < (UINT32)inLen) inBuf[i] = (UINT16)SPI_Read(spi);
+            else SPI_Read(spi);
+        }
+    }
+}
+
+// Polled engine of the SPI controller, one frame at a time
+static void SPI_Legacy(BOOL wide, void* outBuf, INT32 outLen,
+                       void* inBuf, INT32 inLen, INT32 inOffset)
+{
+    INT32 num = (inLen) ? inLen + inOffset : outLen;
+    UINT32 out = 0, in;
+    INT32 i;
+
+    for (INT32 n = 0; n < num; n++)
+    {
+        if (n < outLen) out = (wide) ? ((UINT16*)outBuf)[n] : ((UINT8*)outBuf)[n];
+        LPC_SPI->DR = out;
+        while (!(LPC_SPI->SR & SPI_SR_Spif));
+        in = LPC_SPI->DR;
+        i = n - inOffset;
+        if ((UINT32)i < (UINT32)inLen)
+        {
+            if (wide) ((UINT16*)inBuf)[i] = (UINT16)in;
+            else ((UINT8*)inBuf)[i] = (UINT8)in;
+        }
+    }
+}
+
 BOOL CPU_SPI_Initialize()
 {
+    for (int i = 0; i < TOTAL_SPI_PORT; i++)
+    {
+        spi_bus[i].route = (SPI_Port[i].route < SPI_ROUTES) ? SPI_Port[i].route : 0;
+        if (i < TOTAL_SSP_PORT)
+        {
+            SPI_REG(i)->IMSC = 0;
+            SPI_REG(i)->DMACR = 0;
+        } else {
+            LPC_SPI->CR = 0;
+        }
+        CPU_INTC_ActivateInterrupt(SPI_IRQ(i), SPI_ISR(i), 0);
+        spi_async[i].timer.InitializeForISR(SPI_AsyncTimer, (void*)i);
+
+        // Use GPDMA if configured and two channels are available. RX gets
+        // the lower channel number, which has the higher priority.
+        if (i < TOTAL_SSP_PORT && (LPC43XX_SPI_DMA_PORTS & (1 << i)) && !spi_dma[i].dma)
+        {
+            int rx = GPDMA_ChannelAlloc(SPI_DmaHandler, (void*)i);
+            int tx = GPDMA_ChannelAlloc(SPI_DmaHandler, (void*)i);
+            if (rx >= 0 && tx >= 0)
+            {
+                spi_dma[i].rxCh = rx;
+                spi_dma[i].txCh = tx;
+                spi_dma[i].dma = TRUE;
+            } else {
+                GPDMA_ChannelFree(rx);
+                GPDMA_ChannelFree(tx);
+            }
+        }
+    }
     return TRUE;
 }
 
 void CPU_SPI_Uninitialize()
 {
+    GLOBAL_LOCK(irq);
+
+    for (int i = 0; i < TOTAL_SPI_PORT; i++)
+    {
+        CPU_SPI_Slave_Stop(i);
+        if (i < TOTAL_SSP_PORT) SPI_REG(i)->IMSC = 0;
+        else LPC_SPI->CR &= ~SPI_CR_Spie;
+        CPU_INTC_DeactivateInterrupt(SPI_IRQ(i));
+        if (i < TOTAL_SSP_PORT && spi_dma[i].dma)
+        {
+            SPI_DmaStop(i);
+            GPDMA_ChannelFree(spi_dma[i].txCh);
+            GPDMA_ChannelFree(spi_dma[i].rxCh);
+            spi_dma[i].dma = FALSE;
+        }
+
+        // Fail anything still queued
+        SPI_ASYNC_XACTION *x = spi_async[i].head;
+        spi_async[i].timer.Abort();
+        if (x) CPU_GPIO_SetPinState(x->Configuration.DeviceCS, !x->Configuration.CS_Active);
+        spi_async[i].head = spi_async[i].tail = NULL;
+        spi_async[i].state = SPI_STATE_IDLE;
+        while (x)
+        {
+            SPI_ASYNC_XACTION *next = x->Next;
+            x->Next = NULL;
+            x->Status = SPI_ASYNC_ERROR;
+            if (x->Completion) x->Completion->EnqueueDelta(0);
+            x = next;
+        }
+        CPU_SPI_Bus_Release(i);
+    }
+}
+
+// ---------------------------------------------------------------------------
+static BOOL SPI_AsyncValid(SPI_ASYNC_XACTION* Xaction)
+{
+    if (Xaction == NULL || Xaction->Configuration.SPI_mod >= TOTAL_SPI_PORT) return FALSE;
+    if (SPI_SLAVE_ACTIVE(Xaction->Configuration.SPI_mod)) return FALSE;
+    if (Xaction->WriteCount < 0 || (Xaction->WriteCount && Xaction->Write == NULL)) return FALSE;
+    if (Xaction->ReadCount < 0 || Xaction->ReadStartOffset < 0) return FALSE;
+    if (Xaction->ReadCount ? (Xaction->Read == NULL) : (Xaction->WriteCount == 0)) return FALSE;
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Appends a chain of transactions linked through Next to the port queue and
+// starts it if the port was idle
+static void SPI_AsyncQueue(SPI_ASYNC_XACTION* first, SPI_ASYNC_XACTION* last)
+{
+    SPI_ASYNC_T *as = &spi_async[first->Configuration.SPI_mod];
+
+    GLOBAL_LOCK(irq);
+    if (as->tail)
+    {
+        as->tail->Next = first;
+        as->tail = last;
+    } else {
+        as->head = first;
+        as->tail = last;
+        SPI_AsyncStart(first->Configuration.SPI_mod);
+    }
+}
+
+// ---------------------------------------------------------------------------
+BOOL CPU_SPI_Async_Xaction(SPI_ASYNC_XACTION* Xaction)
+{
+    if (!SPI_AsyncValid(Xaction)) return FALSE;
+
+    Xaction->Status = SPI_ASYNC_PENDING;
+    Xaction->Next = NULL;
+    SPI_AsyncQueue(Xaction, Xaction);
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+BOOL CPU_SPI_Async_Batch(SPI_ASYNC_XACTION* Xactions, INT32 Count, HAL_COMPLETION* Completion)
+{
+    if (Xactions == NULL || Count <= 0) return FALSE;
+
+    UINT32 spi_mod = Xactions[0].Configuration.SPI_mod;
+    INT32 i;
+
+    for (i = 0; i < Count; i++)
+    {
+        if (!SPI_AsyncValid(&Xactions[i])) return FALSE;
+        if (Xactions[i].Configuration.SPI_mod != spi_mod) return FALSE;
+    }
+
+    for (i = 0; i < Count; i++)
+    {
+        Xactions[i].Status = SPI_ASYNC_PENDING;
+        Xactions[i].Completion = NULL;
+        Xactions[i].Next = (i + 1 < Count) ? &Xactions[i + 1] : NULL;
+    }
+    Xactions[Count - 1].Completion = Completion;
+
+    SPI_AsyncQueue(&Xactions[0], &Xactions[Count - 1]);
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+BOOL CPU_SPI_Async_Busy(UINT32 spi_mod)
+{
+    if (spi_mod >= TOTAL_SPI_PORT) return FALSE;
+    return (spi_async[spi_mod].head != NULL) ? TRUE : FALSE;
+}
+
+// ---------------------------------------------------------------------------
+void CPU_SPI_Async_Cancel(UINT32 spi_mod)
+{
+    if (spi_mod >= TOTAL_SPI_PORT) return;
+
+    SPI_ASYNC_T *as = &spi_async[spi_mod];
+    SPI_ASYNC_XACTION *rest, *x;
+
+    GLOBAL_LOCK(irq);
+    if (as->head == NULL) return;
+
+    // Detach the queue, so finishing the head starts nothing
+    as->timer.Abort();
+    rest = as->head->Next;
+    as->head->Next = NULL;
+    as->tail = as->head;
+    if (as->state == SPI_STATE_XFER) SPI_AsyncStop(spi_mod, SPI_ASYNC_ERROR);
+    else SPI_AsyncFinish(spi_mod, SPI_ASYNC_ERROR);
+
+    while (rest)
+    {
+        x = rest;
+        rest = x->Next;
+        x->Next = NULL;
+        x->Status = SPI_ASYNC_ERROR;
+        if (x->Completion) x->Completion->EnqueueDelta(0);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Lets queued transactions finish with the lock released, then returns with
+// it held and the queue empty. FALSE if the caller had interrupts disabled
+// and the queue can't drain.
+static BOOL SPI_AsyncWait(UINT32 spi_mod, SmartPtr_IRQ& irq)
+{
+    while (CPU_SPI_Async_Busy(spi_mod))
+    {
+        if (irq.WasDisabled()) return FALSE;
+        irq.Release();
+        while (CPU_SPI_Async_Busy(spi_mod));
+        irq.Acquire();
+    }
+    return TRUE;
 }
 
 BOOL CPU_SPI_nWrite16_nRead16(const SPI_CONFIGURATION& Configuration, UINT16* Write16, INT32 WriteCount, UINT16* Read16, INT32 ReadCount, INT32 ReadStartOffset)
 {
     GLOBAL_LOCK(irq);
 
+    if (!SPI_AsyncWait(Configuration.SPI_mod, irq)) return FALSE;
     if(!CPU_SPI_Xaction_Start( Configuration )) return FALSE;
 
     SPI_XACTION_16 Transaction;
@@ -176,6 +1142,7 @@ BOOL CPU_SPI_nWrite8_nRead8(const SPI_CONFIGURATION& Configuration, UINT8* Write
 {
     GLOBAL_LOCK(irq);
 
+    if (!SPI_AsyncWait(Configuration.SPI_mod, irq)) return FALSE;
     if(!CPU_SPI_Xaction_Start( Configuration )) return FALSE;
 
     SPI_XACTION_8 Transaction;
@@ -193,25 +1160,16 @@ BOOL CPU_SPI_nWrite8_nRead8(const SPI_CONFIGURATION& Configuration, UINT8* Write
 BOOL CPU_SPI_Xaction_Start(const SPI_CONFIGURATION& Configuration)
 {
     if (Configuration.SPI_mod >= TOTAL_SPI_PORT) return FALSE;
+    if (SPI_SLAVE_ACTIVE(Configuration.SPI_mod)) return FALSE;
 
-    LPC_SSP_T *spi = SPI_REG(Configuration.SPI_mod);
     int Bits, Mode;
 
-    // Configure options and clock
+    // Configure options, clock and pins, registers are only written on change
     Bits = (Configuration.MD_16bits) ? 16 : 8;
     Mode = (Configuration.MSK_IDLE) ? 2 : 0; // ToDo: Check
     Mode |= (!Configuration.MSK_SampleEdge) ? 1 : 0;
-    SPI_Config(spi, Bits, Mode, 0);
-    SPI_Frequency(spi, (1000 * Configuration.Clock_RateKHz));
-    
-    // I/O setup
-    GPIO_PIN msk, miso, mosi;
-    CPU_SPI_GetPins(Configuration.SPI_mod, msk, miso, mosi);
-    UINT32 alternate = 0x252; // AF5 = SPI1/SPI2
-    if (Configuration.SPI_mod == 2) alternate = 0x262; // AF6 = SPI3, speed = 2 (50MHz)
-    CPU_GPIO_DisablePin(msk,  RESISTOR_DISABLED, 1, (GPIO_ALT_MODE)alternate);
-    CPU_GPIO_DisablePin(miso, RESISTOR_DISABLED, 0, (GPIO_ALT_MODE)alternate);
-    CPU_GPIO_DisablePin(mosi, RESISTOR_DISABLED, 1, (GPIO_ALT_MODE)alternate);
+    if (!SPI_Setup(Configuration.SPI_mod, Bits, Mode, Configuration.Clock_RateKHz, FALSE))
+        return FALSE;
 
     // CS setup
     CPU_GPIO_EnableOutputPin(Configuration.DeviceCS, Configuration.CS_Active);
@@ -225,96 +1183,324 @@ BOOL CPU_SPI_Xaction_Start(const SPI_CONFIGURATION& Configuration)
 
 BOOL CPU_SPI_Xaction_Stop(const SPI_CONFIGURATION& Configuration)
 {
-    LPC_SSP_T *spi = SPI_REG(Configuration.SPI_mod);
-    while (SPI_Busy(spi)); // wait for completion
+    // The SPI controller has no FIFO, its last frame ended with SPIF
+    if (Configuration.SPI_mod < TOTAL_SSP_PORT)
+    {
+        LPC_SSP_T *spi = SPI_REG(Configuration.SPI_mod);
+        while (SPI_Busy(spi)); // wait for completion
+    }
 
     if(Configuration.CS_Hold_uSecs)
     {
         HAL_Time_Sleep_MicroSeconds_InterruptEnabled(Configuration.CS_Hold_uSecs);
     }
     CPU_GPIO_SetPinState(Configuration.DeviceCS, !Configuration.CS_Active);
-    GPIO_RESISTOR res = RESISTOR_PULLDOWN;
-    if (Configuration.MSK_IDLE) res = RESISTOR_PULLUP;
-    GPIO_PIN msk, miso, mosi;
-    CPU_SPI_GetPins(Configuration.SPI_mod, msk, miso, mosi);
-    CPU_GPIO_EnableInputPin(msk,  FALSE, NULL, GPIO_INT_NONE, res);
-    CPU_GPIO_EnableInputPin(miso, FALSE, NULL, GPIO_INT_NONE, RESISTOR_PULLDOWN);
-    CPU_GPIO_EnableInputPin(mosi, FALSE, NULL, GPIO_INT_NONE, RESISTOR_PULLDOWN);
-
-    SPI_Disable(spi); // Disable SPI
+
+    // SSP stays enabled and drives SCK at its idle level until released
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Disables the controller and returns its pins to inputs with the idle pulls
+void CPU_SPI_Bus_Release(UINT32 spi_mod)
+{
+    if (spi_mod >= TOTAL_SPI_PORT) return;
+
+    SPI_BUS_T *bus = &spi_bus[spi_mod];
+    const SPI_ROUTE_T *route = SPI_ROUTE(spi_mod);
+
+    GLOBAL_LOCK(irq);
+
+    if (!SPI_AsyncWait(spi_mod, irq)) return;
+    if (bus->muxed)
+    {
+        // Pads only, CPU_GPIO_EnableInputPin would claim a pin interrupt
+        PIN_Config(route->sck.pin, (bus->idle) ? SCU_PINIO_PULLUP : SCU_PINIO_PULLDOWN);
+        PIN_Config(route->miso.pin, SCU_PINIO_PULLDOWN);
+        PIN_Config(route->mosi.pin, SCU_PINIO_PULLDOWN);
+        if (spi_mod == SPI_LEGACY) PIN_Config(route->ssel.pin, SCU_PINIO_PULLUP);
+        bus->muxed = FALSE;
+    }
+    if (spi_mod == SPI_LEGACY) LPC_SPI->CR = 0;
+    else SPI_Disable(SPI_REG(spi_mod));
+    bus->cr0 = bus->cr1 = bus->cpsr = 0; // Force reconfiguration
+}
+
+// ---------------------------------------------------------------------------
+// Releases the bus and moves the port to another pin route
+BOOL CPU_SPI_SetRoute(UINT32 spi_mod, UINT32 Route)
+{
+    if (spi_mod >= TOTAL_SPI_PORT || Route >= SPI_ROUTES) return FALSE;
+    if (SPI_Route[spi_mod][Route].sck.pin == GPIO_PIN_NONE) return FALSE;
+    if (SPI_SLAVE_ACTIVE(spi_mod)) return FALSE;
+
+    CPU_SPI_Bus_Release(spi_mod);
+
+    GLOBAL_LOCK(irq);
+    spi_bus[spi_mod].route = Route;
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+BOOL CPU_SPI_Slave_Start(UINT32 spi_mod, UINT32 Mode, SPI_SLAVE_FRAME_FPN Frame, void* Param)
+{
+    if (spi_mod >= TOTAL_SSP_PORT || Mode > 3) return FALSE;
+    if (!spi_dma[spi_mod].dma || spi_slave[spi_mod].active) return FALSE;
+
+    CPU_SPI_Bus_Release(spi_mod); // Waits for queued master transactions
+
+    LPC_SSP_T *spi = SPI_REG(spi_mod);
+    SPI_SLAVE_T *sl = &spi_slave[spi_mod];
+    SPI_DMA_T *dma = &spi_dma[spi_mod];
+    GPDMA_LLI_T *tx = spi_tx_lli[spi_mod];
+    GPDMA_LLI_T *rx = spi_rx_lli[spi_mod];
+    const SPI_ROUTE_T *route = SPI_ROUTE(spi_mod);
+    UINT32 ctrl;
+
+    GLOBAL_LOCK(irq);
+
+    sl->frame = Frame;
+    sl->param = Param;
+    sl->rxTail = sl->rxFrame = 0;
+    sl->txHead = sl->txPos = sl->txQueued = 0;
+    sl->overruns = 0;
+    memset(spi_slave_tx[spi_mod], SPI_SLAVE_FILL, LPC43XX_SPI_SLAVE_TX_SIZE);
+
+    // 8 bit frames, CPSR is unused by the slave but must be valid
+    spi->CR1 = 0;
+    spi->CR0 = 7 | ((Mode >> 1) & 1) << 6 | (Mode & 1) << 7;
+    spi->CPSR = 2;
+    spi->CR1 = SSP_CR1_Ms;
+    while (SPI_Readable(spi)) SPI_Read(spi);
+
+    PIN_Config(route->sck.pin,  SCU_PINIO_FAST | route->sck.func);
+    PIN_Config(route->miso.pin, SCU_PINIO_FAST | route->miso.func);
+    PIN_Config(route->mosi.pin, SCU_PINIO_FAST | route->mosi.func);
+
+    // Circular lists, every segment raises terminal count
+    ctrl = GPDMA_CTRL_SIZE(SPI_SLAVE_RX_SEGSIZE) | GPDMA_CTRL_SBSIZE(GPDMA_BURST_1)
+           | GPDMA_CTRL_DBSIZE(GPDMA_BURST_1) | GPDMA_CTRL_SWIDTH(GPDMA_WIDTH_BYTE)
+           | GPDMA_CTRL_DWIDTH(GPDMA_WIDTH_BYTE) | GPDMA_CTRL_SRC_AHB1
+           | GPDMA_CTRL_DST_INC | GPDMA_CTRL_TC_IRQ;
+    for (int i = 0; i < SPI_SLAVE_SEGMENTS; i++)
+    {
+        rx[i].src = (UINT32)&spi->DR;
+        rx[i].dst = (UINT32)&spi_slave_rx[spi_mod][i * SPI_SLAVE_RX_SEGSIZE];
+        rx[i].lli = (UINT32)&rx[(i + 1) % SPI_SLAVE_SEGMENTS];
+        rx[i].ctrl = ctrl;
+    }
+    ctrl = GPDMA_CTRL_SIZE(SPI_SLAVE_TX_SEGSIZE) | GPDMA_CTRL_SBSIZE(GPDMA_BURST_1)
+           | GPDMA_CTRL_DBSIZE(GPDMA_BURST_1) | GPDMA_CTRL_SWIDTH(GPDMA_WIDTH_BYTE)
+           | GPDMA_CTRL_DWIDTH(GPDMA_WIDTH_BYTE) | GPDMA_CTRL_DST_AHB1
+           | GPDMA_CTRL_SRC_INC | GPDMA_CTRL_TC_IRQ;
+    for (int i = 0; i < SPI_SLAVE_SEGMENTS; i++)
+    {
+        tx[i].src = (UINT32)&spi_slave_tx[spi_mod][i * SPI_SLAVE_TX_SEGSIZE];
+        tx[i].dst = (UINT32)&spi->DR;
+        tx[i].lli = (UINT32)&tx[(i + 1) % SPI_SLAVE_SEGMENTS];
+        tx[i].ctrl = ctrl;
+    }
+
+    dma->async = FALSE;
+    if (!GPDMA_Transfer(dma->rxCh, rx[0].src, rx[0].dst, rx[0].ctrl, SPI_RxReq(spi_mod),
+                        GPDMA_CFG_P2M, &rx[1])
+        || !GPDMA_Transfer(dma->txCh, tx[0].src, tx[0].dst, tx[0].ctrl, SPI_TxReq(spi_mod),
+                           GPDMA_CFG_M2P, &tx[1]))
+    {
+        SPI_DmaStop(spi_mod);
+        spi->CR1 = 0;
+        return FALSE;
+    }
+    spi->DMACR = SSP_DMA_Rx | SSP_DMA_Tx;
+    spi->CR1 = SSP_CR1_Ms | SSP_CR1_Sse;
+
+    // The pin interrupt follows the pad, so SSEL keeps its SSP function
+    CPU_GPIO_EnableInputPin2(route->ssel.pin, FALSE, SPI_SlaveSsel, (void*)spi_mod,
+                             GPIO_INT_EDGE_HIGH, RESISTOR_PULLUP);
+    PIN_Config(route->ssel.pin, SCU_PINIO_FAST | route->ssel.func);
+
+    sl->active = TRUE;
     return TRUE;
 }
 
+// ---------------------------------------------------------------------------
+void CPU_SPI_Slave_Stop(UINT32 spi_mod)
+{
+    if (!SPI_SLAVE_ACTIVE(spi_mod)) return;
+
+    LPC_SSP_T *spi = SPI_REG(spi_mod);
+    SPI_BUS_T *bus = &spi_bus[spi_mod];
+    const SPI_ROUTE_T *route = SPI_ROUTE(spi_mod);
+
+    GLOBAL_LOCK(irq);
+
+    spi_slave[spi_mod].active = FALSE;
+    CPU_GPIO_DisablePin(route->ssel.pin, RESISTOR_PULLUP, 0, GPIO_ALT_PRIMARY);
+    PIN_Config(route->ssel.pin, SCU_PINIO_PULLUP);
+    SPI_DmaStop(spi_mod);
+    spi->CR1 = 0;
+
+    PIN_Config(route->sck.pin, SCU_PINIO_PULLDOWN);
+    PIN_Config(route->miso.pin, SCU_PINIO_PULLDOWN);
+    PIN_Config(route->mosi.pin, SCU_PINIO_PULLDOWN);
+    bus->muxed = FALSE;
+    bus->cr0 = bus->cr1 = bus->cpsr = 0; // Master mode reconfigures
+}
+
+// ---------------------------------------------------------------------------
+UINT8* CPU_SPI_Slave_RxSpan(UINT32 spi_mod, UINT32 Offset, UINT32& Length)
+{
+    Length = 0;
+    if (!SPI_SLAVE_ACTIVE(spi_mod)) return NULL;
+
+    SPI_SLAVE_T *sl = &spi_slave[spi_mod];
+    UINT32 tail, avail;
+
+    GLOBAL_LOCK(irq);
+
+    // Only complete frames are handed out
+    avail = (sl->rxFrame + LPC43XX_SPI_SLAVE_RX_SIZE - sl->rxTail) % LPC43XX_SPI_SLAVE_RX_SIZE;
+    if (Offset >= avail) return NULL;
+
+    tail = (sl->rxTail + Offset) % LPC43XX_SPI_SLAVE_RX_SIZE;
+    Length = avail - Offset;
+    if (Length > LPC43XX_SPI_SLAVE_RX_SIZE - tail) Length = LPC43XX_SPI_SLAVE_RX_SIZE - tail;
+    return &spi_slave_rx[spi_mod][tail];
+}
+
+// ---------------------------------------------------------------------------
+void CPU_SPI_Slave_RxConsume(UINT32 spi_mod, UINT32 Count)
+{
+    if (!SPI_SLAVE_ACTIVE(spi_mod)) return;
+
+    SPI_SLAVE_T *sl = &spi_slave[spi_mod];
+    UINT32 avail;
+
+    GLOBAL_LOCK(irq);
+    avail = (sl->rxFrame + LPC43XX_SPI_SLAVE_RX_SIZE - sl->rxTail) % LPC43XX_SPI_SLAVE_RX_SIZE;
+    if (Count > avail) Count = avail;
+    sl->rxTail = (sl->rxTail + Count) % LPC43XX_SPI_SLAVE_RX_SIZE;
+}
+
+// ---------------------------------------------------------------------------
+UINT32 CPU_SPI_Slave_Write(UINT32 spi_mod, const UINT8* Data, UINT32 Count)
+{
+    if (!SPI_SLAVE_ACTIVE(spi_mod)) return 0;
+
+    SPI_SLAVE_T *sl = &spi_slave[spi_mod];
+    UINT8 *buf = spi_slave_tx[spi_mod];
+    UINT32 space, i;
+
+    GLOBAL_LOCK(irq);
+
+    // A segment stays free so the DMA never reads bytes being written
+    SPI_SlaveTxSync(spi_mod);
+    space = LPC43XX_SPI_SLAVE_TX_SIZE - SPI_SLAVE_TX_SEGSIZE - sl->txQueued;
+    if (Count > space) Count = space;
+
+    for (i = 0; i < Count; i++)
+    {
+        buf[sl->txHead] = Data[i];
+        if (++sl->txHead >= LPC43XX_SPI_SLAVE_TX_SIZE) sl->txHead = 0;
+    }
+    sl->txQueued += Count;
+    return Count;
+}
+
 BOOL CPU_SPI_Xaction_nWrite16_nRead16(SPI_XACTION_16& Transaction)
 {
-    LPC_SSP_T *spi = SPI_REG(Transaction.SPI_mod);
-    
-    UINT16* outBuf = Transaction.Write16;
-    UINT16* inBuf  = Transaction.Read16;
-    INT32 outLen = Transaction.WriteCount;
-    INT32 num, ii, i = 0;
-    
-    if (Transaction.ReadCount) { // write & read
-        num = Transaction.ReadCount + Transaction.ReadStartOffset;
-        ii = -Transaction.ReadStartOffset;
-    } else { // write only
-        num = outLen;
-        ii = 0x80000000; // disable write to inBuf
-    }
-
-    UINT16 out = outBuf[0];
-    UINT16 in;
-    SPI_Write(spi, out); // write first word
-    while (++i < num) {
-        if (i < outLen) out = outBuf[i]; // get new output data
-        while (!(SPI_Readable(spi))); // wait for Rx buffer
-        in = SPI_Read(spi); // read input
-        SPI_Write(spi, out); // start output
-        if (ii >= 0) inBuf[ii] = in; // save input data
-        ii++;
-    }
-    while (!(SPI_Readable(spi))); // wait for Rx buffer
-    in = SPI_Read(spi); // read last input
-    if (ii >= 0) inBuf[ii] = in; // save last input
+    if (Transaction.SPI_mod == SPI_LEGACY)
+    {
+        SPI_Legacy(TRUE, Transaction.Write16, Transaction.WriteCount,
+                   Transaction.Read16, Transaction.ReadCount, Transaction.ReadStartOffset);
+        return TRUE;
+    }
+
+    // Long transfers run on GPDMA, interrupts are already disabled by the caller
+    if (SPI_DmaStart(Transaction.SPI_mod, TRUE, Transaction.Write16, Transaction.WriteCount,
+                     Transaction.Read16, Transaction.ReadCount, Transaction.ReadStartOffset, FALSE))
+    {
+        BOOL ok = SPI_DmaWait(Transaction.SPI_mod, (Transaction.ReadCount)
+                              ? Transaction.ReadCount + Transaction.ReadStartOffset
+                              : Transaction.WriteCount);
+        SPI_DmaStop(Transaction.SPI_mod);
+        return ok;
+    }
 
+    SPI_Fifo16(SPI_REG(Transaction.SPI_mod), Transaction.Write16, Transaction.WriteCount,
+               Transaction.Read16, Transaction.ReadCount, Transaction.ReadStartOffset);
     return TRUE;
 }
 
 BOOL CPU_SPI_Xaction_nWrite8_nRead8( SPI_XACTION_8& Transaction )
 {
-    LPC_SSP_T *spi = SPI_REG(Transaction.SPI_mod);
-    
-    UINT8* outBuf = Transaction.Write8;
-    UINT8* inBuf  = Transaction.Read8;
-    INT32 outLen = Transaction.WriteCount;
-    INT32 num, ii, i = 0;
-    
-    if (Transaction.ReadCount) { // write & read
-        num = Transaction.ReadCount + Transaction.ReadStartOffset;
-        ii = -Transaction.ReadStartOffset;
-    } else { // write only
-        num = outLen;
-        ii = 0x80000000; // disable write to inBuf
-    }
-
-    UINT8 out = outBuf[0];
-    UINT16 in;
-    SPI_Write(spi, out); // write first word
-    while (++i < num) {
-        if (i < outLen) out = outBuf[i]; // get new output data
-        while (!(SPI_Readable(spi))); // wait for Rx buffer
-        in = SPI_Read(spi); // read input
-        SPI_Write(spi, out); // start output
-        if (ii >= 0) inBuf[ii] = (UINT8)in; // save input data
-        ii++;
-    }
-    while (!(SPI_Readable(spi))); // wait for Rx buffer
-    in = SPI_Read(spi); // read last input
-    if (ii >= 0) inBuf[ii] = (UINT8)in; // save last input
+    if (Transaction.SPI_mod == SPI_LEGACY)
+    {
+        SPI_Legacy(FALSE, Transaction.Write8, Transaction.WriteCount,
+                   Transaction.Read8, Transaction.ReadCount, Transaction.ReadStartOffset);
+        return TRUE;
+    }
+
+    // Long transfers run on GPDMA, interrupts are already disabled by the caller
+    if (SPI_DmaStart(Transaction.SPI_mod, FALSE, Transaction.Write8, Transaction.WriteCount,
+                     Transaction.Read8, Transaction.ReadCount, Transaction.ReadStartOffset, FALSE))
+    {
+        BOOL ok = SPI_DmaWait(Transaction.SPI_mod, (Transaction.ReadCount)
+                              ? Transaction.ReadCount + Transaction.ReadStartOffset
+                              : Transaction.WriteCount);
+        SPI_DmaStop(Transaction.SPI_mod);
+        return ok;
+    }
 
+    SPI_Fifo8(SPI_REG(Transaction.SPI_mod), Transaction.Write8, Transaction.WriteCount,
+              Transaction.Read8, Transaction.ReadCount, Transaction.ReadStartOffset);
     return TRUE;
 }
 
+// ---------------------------------------------------------------------------
+// Runs the polled engine in SSP loopback mode. RX data comes from the shifter,
+// but SPI_Setup muxes the port pins and SCK and MOSI toggle on them, so no
+// device on the bus may be selected. Returns the effective bit rate, compare
+// with ClockKHz * 1000.
+UINT32 CPU_SPI_Benchmark(UINT32 spi_mod, UINT32 ClockKHz, BOOL Wide, INT32 Frames)
+{
+    LPC_SSP_T *spi;
+    UINT16 *buf;
+    UINT32 cycles;
+
+    if (spi_mod >= TOTAL_SSP_PORT || Frames <= 0 || Frames > SPI_BENCHMARK_FRAMES) return 0;
+    if (SPI_SLAVE_ACTIVE(spi_mod)) return 0;
+    spi = SPI_REG(spi_mod);
+
+    buf = (UINT16 *)private_malloc(Frames * sizeof(UINT16));
+    if (buf == NULL) return 0;
+    for (int i = 0; i < Frames; i++) buf[i] = (UINT16)(i * 0x0101);
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    {
+        GLOBAL_LOCK(irq);
+
+        if (!SPI_AsyncWait(spi_mod, irq) || !SPI_Setup(spi_mod, (Wide) ? 16 : 8, 0, ClockKHz, FALSE))
+        {
+            cycles = 0;
+        } else {
+            spi->CR1 |= SSP_CR1_Lbm;
+
+            cycles = DWT->CYCCNT;
+            if (Wide) SPI_Fifo16(spi, buf, Frames, buf, Frames, 0);
+            else SPI_Fifo8(spi, (UINT8*)buf, Frames, (UINT8*)buf, Frames, 0);
+            cycles = DWT->CYCCNT - cycles;
+
+            spi->CR1 &= ~SSP_CR1_Lbm;
+        }
+    }
+
+    private_free(buf);
+    if (cycles == 0) return 0;
+    return (UINT32)((UINT64)Frames * ((Wide) ? 16 : 8) * SystemCoreClock / cycles);
+}
+
 UINT32 CPU_SPI_PortsCount()
 {
     return TOTAL_SPI_PORT;
@@ -328,9 +1514,10 @@ void CPU_SPI_GetPins(UINT32 spi_mod, GPIO_PIN& msk, GPIO_PIN& miso, GPIO_PIN& mo
         miso = GPIO_PIN_NONE;
         mosi = GPIO_PIN_NONE;
     } else {
-        msk  = SPI_MSK(spi_mod);
-        miso = SPI_MISO(spi_mod);
-        mosi = SPI_MOSI(spi_mod);
+        const SPI_ROUTE_T *route = SPI_ROUTE(spi_mod);
+        msk  = route->sck.pin;
+        miso = route->miso.pin;
+        mosi = route->mosi.pin;
     }
 
     return;
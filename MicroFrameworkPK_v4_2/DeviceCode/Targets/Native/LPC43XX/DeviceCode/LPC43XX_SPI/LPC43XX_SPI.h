@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////
+// LPC43XX_SPI.h - SPI declarations for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _LPC43XX_SPI_H_
+#define _LPC43XX_SPI_H_
+
+// LPC43XX extensions to the SPI HAL
+
+// Asynchronous transaction status
+#define SPI_ASYNC_PENDING  0
+#define SPI_ASYNC_DONE     1
+#define SPI_ASYNC_ERROR    2
+
+// Asynchronous transaction. Frames are 8 or 16 bits per
+// Configuration.MD_16bits and Write/Read point to UINT8 or UINT16 buffers.
+// The descriptor and buffers must stay valid until Status leaves
+// SPI_ASYNC_PENDING. Completion, if not NULL, is enqueued at that point.
+typedef struct SPI_ASYNC_XACTION
+{
+  SPI_CONFIGURATION Configuration;
+  void* Write;
+  INT32 WriteCount;
+  void* Read;
+  INT32 ReadCount;
+  INT32 ReadStartOffset;
+  HAL_COMPLETION* Completion;
+  volatile INT32 Status;
+  struct SPI_ASYNC_XACTION* Next;  // Driver use
+} SPI_ASYNC_XACTION;
+
+// Queues a transaction on its SPI_mod and returns without waiting. Transfers
+// are driven by the SSP interrupt, interrupts stay enabled while they run.
+// CS_Setup_uSecs and CS_Hold_uSecs are timed with a HAL completion.
+BOOL CPU_SPI_Async_Xaction(SPI_ASYNC_XACTION* Xaction);
+// Queues Count transactions from an array as one batch, in order and back to
+// back. All must use the same SPI_mod, DeviceCS may differ. Their Completion
+// fields are overwritten: only Completion is enqueued, once, after the last
+// one. Any invalid entry rejects the whole batch.
+BOOL CPU_SPI_Async_Batch(SPI_ASYNC_XACTION* Xactions, INT32 Count, HAL_COMPLETION* Completion);
+// TRUE while transactions are queued or running on the port
+BOOL CPU_SPI_Async_Busy(UINT32 spi_mod);
+// Stops the running transaction, releases its CS and fails it and every
+// queued one with SPI_ASYNC_ERROR. Their completions are enqueued.
+void CPU_SPI_Async_Cancel(UINT32 spi_mod);
+
+// Pins stay assigned to the SSP between transactions. Releases them so
+// they can be used for something else, the next transaction takes them back.
+void CPU_SPI_Bus_Release(UINT32 spi_mod);
+
+// SPI_mod 0 and 1 are the SSPs, 2 is the SPI controller (8 to 16 bit
+// frames, master only, no DMA). Each has up to 3 pin routes: SSP0 on
+// P3_0/P1_1/P1_2, P3_3/P3_7/P3_8 or PF_0/PF_2/PF_3, SSP1 on PF_4/P1_3/P1_4,
+// P1_19/P0_0/P0_1 or PF_4/PF_6/PF_7, SPI on P3_3/P3_6/P3_7 only. Routes on
+// port 3 share the SPIFI pads. Switching releases the bus first, fails while
+// the port is in slave mode or the route does not exist.
+BOOL CPU_SPI_SetRoute(UINT32 spi_mod, UINT32 Route);
+
+// Slave mode, 8 bit frames clocked by an external master. Needs the port in
+// LPC43XX_SPI_DMA_PORTS and SCK at most 1/12 of the SSP clock. Received
+// bytes land in a DMA ring, Frame is called from the SSEL interrupt with the
+// length of each frame and the running count of dropped ring segments.
+// Master transactions on the port fail until CPU_SPI_Slave_Stop.
+typedef void (*SPI_SLAVE_FRAME_FPN)(void* Param, UINT32 Length, UINT32 Overruns);
+
+BOOL CPU_SPI_Slave_Start(UINT32 spi_mod, UINT32 Mode, SPI_SLAVE_FRAME_FPN Frame, void* Param);
+void CPU_SPI_Slave_Stop(UINT32 spi_mod);
+// Contiguous received data of completed frames starting Offset bytes past
+// the oldest unconsumed byte, NULL if none. Two calls cover a wrap.
+UINT8* CPU_SPI_Slave_RxSpan(UINT32 spi_mod, UINT32 Offset, UINT32& Length);
+void CPU_SPI_Slave_RxConsume(UINT32 spi_mod, UINT32 Count);
+// Queues bytes for the master to clock out, returns how many fit. TX is a
+// stream, not aligned to frames. Fill bytes go out when the queue runs dry.
+UINT32 CPU_SPI_Slave_Write(UINT32 spi_mod, const UINT8* Data, UINT32 Count);
+
+// Effective bit rate of the polled FIFO engine for Frames (up to 512) 8 or
+// 16 bit frames at ClockKHz, measured with the DWT cycle counter in SSP
+// loopback mode. The port pins are muxed and toggle, deselect all devices.
+// Returns 0 on bad arguments or while the port is a slave.
+UINT32 CPU_SPI_Benchmark(UINT32 spi_mod, UINT32 ClockKHz, BOOL Wide, INT32 Frames);
+
+#endif // _LPC43XX_SPI_H_
@@ -21,33 +21,247 @@
 #include "LPC43XX.h"
 
 #include "LPC43XX_SPIFI.h"
+#if LPC43XX_SPIFI_DMA_THRESHOLD > 0
+#include "..\LPC43XX_GPDMA\LPC43XX_GPDMA.h"
+#endif
 
 #define SPIFI_MEM_BASE    0x14000000
 
-// Winbond W25Q32FV / W25Q64FV
+// Driver geometry. The commands for each size are read from the flash, a
+// 4K erase is required.
 #define SPIFI_BLOCK_SIZE    (64 * 1024)
 #define SPIFI_BLOCK_MASK    (SPIFI_BLOCK_SIZE - 1)
 #define SPIFI_SECTOR_SIZE   (4 * 1024)
 #define SPIFI_SECTOR_MASK   (SPIFI_SECTOR_SIZE - 1)
+#define SPIFI_HALF_BLOCK    (32 * 1024)
+#define SPIFI_PAGE_SIZE     256 // Largest page program
 
 #define SPIFI_SECTOR_WORDS  (SPIFI_SECTOR_SIZE / sizeof(UINT32))
-#define SPIFI_WRITE_SIZE    64  // 32-bit words (4-byte)
+#define SPIFI_PAGE_WORDS    (SPIFI_PAGE_SIZE / sizeof(UINT32))
+
+UINT32 sector_buf[SPIFI_SECTOR_WORDS]; // Sector image for updates
+
+// SPIFI flash is mapped at 0x14000000 and 0x80000000
+#define SPIFI_IS_FLASH(a)   ((((a) & 0xFC000000) == 0x14000000) || (((a) & 0xF8000000) == 0x80000000))
+#define SPIFI_NVIC_REGS     3   // Peripheral interrupts, as in LPC43XX_INTC
+#define SPIFI_SYSTICK_VECTOR 15  // System exception, not in the NVIC registers
+#define SPIFI_SYSTICK_ON    (1 << 0)
+#define SPIFI_SYSTICK_PEND  (1 << 1)
+
+#define SPIFI_BFPT_WORDS    16  // Basic flash parameter table words used
+#define SFDP_SIGNATURE      0x50444653  // "SFDP"
+
+// Winbond W25Q32FV, kept when the flash has no SFDP tables
+static SPIFI_FLASH_INFO spifi_flash =
+{
+    0,                      // JedecId
+    FLASH_MEMORY_Size,      // Size
+    SPIFI_PAGE_SIZE,        // PageSize
+    {CMD_ERASE_SECT, CMD_ERASE_HALF, CMD_ERASE_BLOCK},
+    SPIFI_READ_QUAD,        // ReadCmd
+    SPIFI_CMD(CMD_READ_QUAD, CMD_FRAME_03, 2, (3 << 16)), // MemCmd
+    IDATA_NO_OPCODE,        // ReadIdata
+    SPIFI_PROG,             // ProgCmd
+    0, 0,                   // ProgMaxUsec, EraseMaxUsec
+    0, 0,                   // ProgUsec, EraseUsec
+    0,                      // ClockKHz
+    FALSE,                  // EraseSuspend
+};
+
+static UINT32 spifi_primask;                    // Interrupt state of the caller
+static UINT32 spifi_irq_mask[SPIFI_NVIC_REGS];  // Masked while in command mode
+static UINT32 spifi_systick;                    // SysTick held off, SPIFI_SYSTICK_*
+
+// Sectors known to be erased, one bit each. Set by erases and by scans that
+// find a whole sector blank, cleared by page programs. Starts out empty.
+#define SPIFI_MAP_SECTORS   (FLASH_MEMORY_Size / SPIFI_SECTOR_SIZE)
+#define SPIFI_MAP_BIT(s)    (1UL << ((s) & 31))
+#define SPIFI_MAP_SET(s)    if ((s) < SPIFI_MAP_SECTORS) spifi_erased[(s) >> 5] |= SPIFI_MAP_BIT(s)
+#define SPIFI_MAP_CLEAR(s)  if ((s) < SPIFI_MAP_SECTORS) spifi_erased[(s) >> 5] &= ~SPIFI_MAP_BIT(s)
+
+static UINT32 spifi_erased[(SPIFI_MAP_SECTORS + 31) / 32];
 
-UINT32 sector_buf[SPIFI_SECTOR_WORDS]; // To support partial sector updates
+#if LPC43XX_SPIFI_DMA_THRESHOLD > 0
+static volatile UINT32 spifi_dma_status; // GPDMA_STATUS_* of the running item
+#endif
 
 // Local functions
 static void SPIFI_SetCmdMode(void);
 static void SPIFI_SetMemMode(void);
+static void SPIFI_MaskFlashIrqs(void);
 static void SPIFI_SendCmd(UINT32 Command);
-static void SPIFI_WriteSector(UINT32* dstAddr, UINT32* srcAddr, UINT32 nBytes);
+static UINT8 SPIFI_WaitReady(void);
+static UINT32 SPIFI_WaitErase(void);
+static UINT32 SPIFI_Erase(UINT32 Address, UINT8 Opcode);
+static void SPIFI_ReadSfdp(UINT32 Address, UINT32* Data, UINT32 Count);
+static void SPIFI_ParseSfdp(void);
+static UINT32 SPIFI_ClockKHz(void);
+static void SPIFI_ProgramPage(UINT32 Address, const UINT32* Data);
+static void SPIFI_WriteSector(UINT32 dstAddr, const UINT32* srcAddr, UINT32 nBytes);
+static void SPIFI_CopyWords(UINT32* dst, const UINT32* src, UINT32 nWords);
+static BOOL SPIFI_IsBlank(const UINT32* p, UINT32 nWords);
+#if LPC43XX_SPIFI_DMA_THRESHOLD > 0
+static UINT32 SPIFI_DmaCopy(UINT32* dst, const UINT32* src, UINT32 nWords);
+static void SPIFI_DmaHandler(void* param, UINT32 status);
+#endif
 
 #pragma arm section code = "SectionForFlashOperations"
 // ---------------------------------------------------------------------------
+// Reads the JEDEC ID and the SFDP tables and picks the commands before the
+// flash goes back to memory mode with the selected read. The quad enable bit
+// is left as the boot ROM set it.
 BOOL LPC43XX_SPIFI_Driver::ChipInitialize(void* context)
 {
     NATIVE_PROFILE_HAL_DRIVERS_FLASH();
+
+    MEMORY_MAPPED_NOR_BLOCK_CONFIG* config = (MEMORY_MAPPED_NOR_BLOCK_CONFIG*)context;
+    UINT32 id;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; // Cycle counter for timings
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    SPIFI_SetCmdMode();
+    LPC_SPIFI->CMD = SPIFI_READ_ID | 3;
+    id = LPC_SPIFI->DATA_BYTE << 16;
+    id |= LPC_SPIFI->DATA_BYTE << 8;
+    id |= LPC_SPIFI->DATA_BYTE;
+    while (LPC_SPIFI->STAT & STAT_CMD);
+    spifi_flash.JedecId = id;
+    // Suspend status is in a different place on every vendor, only the
+    // Winbond one (READ_STATUS2 bit 7) is known
+    spifi_flash.EraseSuspend = ((id >> 16) == 0xEF);
+    SPIFI_ParseSfdp();
+    spifi_flash.ClockKHz = SPIFI_ClockKHz();
+    SPIFI_SetMemMode();
+
+    if (config && id != 0 && id != 0xFFFFFF) {
+        config->ManufacturerCode = id >> 16;
+        config->DeviceCode = id & 0xFFFF;
+    }
     return TRUE;
 }
+
+// ---------------------------------------------------------------------------
+// SPIFI clock from divider E
+static UINT32 SPIFI_ClockKHz(void)
+{
+    UINT32 idiv = LPC_CGU->IDIV_CTRL[CLK_IDIV_E];
+    UINT32 div = ((idiv >> 2) & 0xFF) + 1;
+
+    if (((idiv >> 24) & 0x1F) == CLKIN_PLL1) return SystemCoreClock / 1000 / div;
+    if (((idiv >> 24) & 0x1F) == CLKIN_IRC) return 12000 / div;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Reads Count bytes, a multiple of 4, of the SFDP area in command mode
+static void SPIFI_ReadSfdp(UINT32 Address, UINT32* Data, UINT32 Count)
+{
+    LPC_SPIFI->ADDR = Address;
+    LPC_SPIFI->CMD = SPIFI_READ_SFDP | Count;
+    for (; Count >= 4; Count -= 4)
+        *Data++ = LPC_SPIFI->DATA;
+    while (LPC_SPIFI->STAT & STAT_CMD);
+}
+
+// ---------------------------------------------------------------------------
+// Picks the fastest read, the page program and the erase commands from the
+// JEDEC basic flash parameter table (JESD216) along with the maximum program
+// and erase times. Missing fields keep the defaults. Dual modes are not used,
+// the SPIFI is set up for quad. Continuous read (no opcode) is only used on
+// parts known to take 0xA5 as mode bits.
+static void SPIFI_ParseSfdp(void)
+{
+    UINT32 head[4], bfpt[SPIFI_BFPT_WORDS], erase_usec[3];
+    UINT32 mfg = spifi_flash.JedecId >> 16;
+    UINT32 words, i, n, dw, op, clocks, mode, size, unit, usec;
+
+    SPIFI_ReadSfdp(0, head, sizeof(head));
+    if (head[0] != SFDP_SIGNATURE || (head[2] & 0xFF) != 0) return; // First table is the basic one
+    words = head[2] >> 24;
+    if (words > SPIFI_BFPT_WORDS) words = SPIFI_BFPT_WORDS;
+    if (words < 9) return;
+    SPIFI_ReadSfdp(head[3] & 0xFFFFFF, bfpt, words * sizeof(UINT32));
+
+    // Density in bits, 3 byte addresses reach 16M
+    dw = bfpt[1];
+    if (dw & 0x80000000)
+        size = ((dw & 0x7FFFFFFF) >= 3 && (dw & 0x7FFFFFFF) < 35) ? 1UL << ((dw & 0x7FFFFFFF) - 3) : 0;
+    else
+        size = (dw >> 3) + 1;
+    if (size == 0 || size > 0x01000000) size = 0x01000000;
+    spifi_flash.Size = size;
+
+    // 1-4-4 fast read, quad address and data, mode bits in the first byte
+    dw = bfpt[2];
+    op = (dw >> 8) & 0xFF;
+    mode = (dw >> 5) & 0x07;
+    clocks = (dw & 0x1F) + mode;
+    if ((bfpt[0] & (1 << 21)) && op && !(clocks & 1)) {
+        spifi_flash.ReadCmd = SPIFI_CMD(op, CMD_FRAME_13, 2, ((clocks / 2) << 16));
+        if (mode >= 2 && (mfg == 0xEF || mfg == 0xC2 || mfg == 0x01)) {
+            spifi_flash.MemCmd = SPIFI_CMD(op, CMD_FRAME_03, 2, ((clocks / 2) << 16));
+            spifi_flash.ReadIdata = IDATA_NO_OPCODE;
+        } else {
+            spifi_flash.MemCmd = spifi_flash.ReadCmd;
+            spifi_flash.ReadIdata = IDATA_OPCODE;
+        }
+    } else {
+        // 1-1-4 fast read, quad data only, or the serial fast read
+        op = dw >> 24;
+        clocks = ((dw >> 16) & 0x1F) + ((dw >> 21) & 0x07);
+        if ((bfpt[0] & (1 << 22)) && op && !(clocks & 7))
+            spifi_flash.ReadCmd = SPIFI_CMD(op, CMD_FRAME_13, 1, ((clocks / 8) << 16));
+        else
+            spifi_flash.ReadCmd = SPIFI_READ_FAST;
+        spifi_flash.MemCmd = spifi_flash.ReadCmd;
+        spifi_flash.ReadIdata = IDATA_OPCODE;
+    }
+
+    // Quad input page program where quad reads work. Macronix only has the
+    // quad address form.
+    if (spifi_flash.ReadCmd == SPIFI_READ_FAST)
+        spifi_flash.ProgCmd = SPIFI_PROG_SERIAL;
+    else if (mfg == 0xC2)
+        spifi_flash.ProgCmd = SPIFI_PROG_4PP;
+    else
+        spifi_flash.ProgCmd = SPIFI_PROG;
+
+    // Erase types 1 to 4, each 2^N bytes, with their typical times. Sizes
+    // not listed are not used.
+    if ((bfpt[0] & 0x03) == 0x01) spifi_flash.EraseOp[0] = (bfpt[0] >> 8) & 0xFF;
+    if ((bfpt[7] | bfpt[8]) != 0) spifi_flash.EraseOp[1] = spifi_flash.EraseOp[2] = 0;
+    for (i = 0; i < 3; i++) erase_usec[i] = 0;
+    for (i = 0; i < 4; i++) {
+        dw = bfpt[7 + i / 2] >> ((i & 1) * 16);
+        size = dw & 0xFF;
+        op = (dw >> 8) & 0xFF;
+        if (op == 0 || (size != 12 && size != 15 && size != 16)) continue;
+        n = (size == 12) ? 0 : (size == 15) ? 1 : 2;
+        spifi_flash.EraseOp[n] = op;
+        if (words >= 10) {
+            // Units of 1, 16, 128 or 1000 msec. Computed, a constant table
+            // would be read from SPIFI.
+            dw = bfpt[9] >> (4 + 7 * i);
+            unit = (dw >> 5) & 0x03;
+            unit = (unit == 3) ? 1000 : 1UL << (unit * 4 - (unit >> 1));
+            erase_usec[n] = ((dw & 0x1F) + 1) * unit * 1000;
+        }
+    }
+
+    // Maximum is typical times 2 * (multiplier + 1)
+    if (words >= 10) {
+        usec = spifi_flash.EraseOp[2] ? erase_usec[2] : spifi_flash.EraseOp[1] ? 2 * erase_usec[1] : 16 * erase_usec[0];
+        spifi_flash.EraseMaxUsec = 2 * ((bfpt[9] & 0x0F) + 1) * usec;
+    }
+    if (words >= 11) {
+        dw = bfpt[10];
+        size = 1UL << ((dw >> 4) & 0x0F);
+        if (size >= 16 && size < SPIFI_PAGE_SIZE) spifi_flash.PageSize = size;
+        usec = (((dw >> 8) & 0x1F) + 1) * ((dw & (1 << 13)) ? 64 : 8);
+        spifi_flash.ProgMaxUsec = 2 * ((dw & 0x0F) + 1) * usec;
+    }
+}
 #pragma arm section code
 
 // ---------------------------------------------------------------------------
@@ -72,22 +286,107 @@ BOOL LPC43XX_SPIFI_Driver::Read(void* context, ByteAddress StartSector, UINT32 N
     NATIVE_PROFILE_HAL_DRIVERS_FLASH();
 
     if (pSectorBuff == NULL) return FALSE;
+#if LPC43XX_SPIFI_FTL_SIZE > 0
+    if (SPIFI_FTL_OWNS(StartSector)) return SPIFI_FTL_Read(StartSector, NumBytes, pSectorBuff);
+#endif
 
-    UINT32* ChipAddress = (UINT32 *)StartSector;
-    UINT32* EndAddress  = (UINT32 *)(StartSector + NumBytes);
-    UINT32 *pBuf        = (UINT32 *)pSectorBuff;
+    SPIFI_Copy(pSectorBuff, StartSector, NumBytes);
+    return TRUE;
+}
 
-    while(ChipAddress < EndAddress)
-    {
-        *pBuf++ = *ChipAddress++;
+// ---------------------------------------------------------------------------
+// Copies from the memory map. The bulk of the copy is done in words once the
+// source is aligned, on GPDMA when it is long enough.
+void SPIFI_Copy(BYTE* Dst, ByteAddress Src, UINT32 NumBytes)
+{
+    const BYTE* src = (const BYTE *)Src;
+    UINT32 n, done = 0;
+
+    while (NumBytes > 0 && ((UINT32)src & 3)) {
+        *Dst++ = *src++;
+        NumBytes--;
+    }
+    if ((UINT32)Dst & 3) { // Misaligned with the source, the library copy shifts
+        memcpy(Dst, src, NumBytes);
+        return;
     }
 
-    return TRUE;
+    n = NumBytes / sizeof(UINT32);
+#if LPC43XX_SPIFI_DMA_THRESHOLD > 0
+    if (NumBytes >= LPC43XX_SPIFI_DMA_THRESHOLD) done = SPIFI_DmaCopy((UINT32 *)Dst, (const UINT32 *)src, n);
+#endif
+    SPIFI_CopyWords((UINT32 *)Dst + done, (const UINT32 *)src + done, n - done);
+
+    // Tail bytes
+    for (n *= sizeof(UINT32); n < NumBytes; n++)
+        Dst[n] = src[n];
+}
+
+// ---------------------------------------------------------------------------
+// Eight words per pass, the compiler turns them into an LDM/STM pair
+static void SPIFI_CopyWords(UINT32* dst, const UINT32* src, UINT32 nWords)
+{
+    UINT32 a, b, c, d, e, f, g, h;
+
+    for (; nWords >= 8; nWords -= 8) {
+        a = src[0]; b = src[1]; c = src[2]; d = src[3];
+        e = src[4]; f = src[5]; g = src[6]; h = src[7];
+        dst[0] = a; dst[1] = b; dst[2] = c; dst[3] = d;
+        dst[4] = e; dst[5] = f; dst[6] = g; dst[7] = h;
+        src += 8;
+        dst += 8;
+    }
+    while (nWords--) *dst++ = *src++;
+}
+
+#if LPC43XX_SPIFI_DMA_THRESHOLD > 0
+// ---------------------------------------------------------------------------
+// Memory to memory GPDMA copy, waits for each item. The CPU spins on a
+// register meanwhile, so code fetches from SPIFI don't break up the read
+// bursts. The channel is taken for the call only, the 8 channels are shared
+// with the serial drivers. Returns the words copied up to the first item
+// that failed, 0 if no channel is free.
+static UINT32 SPIFI_DmaCopy(UINT32* dst, const UINT32* src, UINT32 nWords)
+{
+    UINT32 ctrl = GPDMA_CTRL_SBSIZE(GPDMA_BURST_4) | GPDMA_CTRL_DBSIZE(GPDMA_BURST_4)
+                  | GPDMA_CTRL_SWIDTH(GPDMA_WIDTH_WORD) | GPDMA_CTRL_DWIDTH(GPDMA_WIDTH_WORD)
+                  | GPDMA_CTRL_DST_AHB1 | GPDMA_CTRL_SRC_INC | GPDMA_CTRL_DST_INC;
+    UINT32 n, done = 0;
+    int ch = GPDMA_ChannelAlloc(SPIFI_DmaHandler, NULL);
+
+    if (ch < 0) return 0;
+
+    while (done < nWords) {
+        n = nWords - done;
+        if (n > GPDMA_MAX_SIZE) n = GPDMA_MAX_SIZE;
+        spifi_dma_status = 0;
+        if (!GPDMA_Transfer(ch, (UINT32)(src + done), (UINT32)(dst + done),
+                            ctrl | GPDMA_CTRL_SIZE(n), GPDMA_REQ_NONE, GPDMA_CFG_M2M, NULL)) break;
+        while (GPDMA_Busy(ch));
+        // The handler sees the error if interrupts are on, the raw status if not
+        if ((spifi_dma_status & GPDMA_STATUS_ERR) || GPDMA_Error(ch)) break;
+        done += n;
+    }
+    GPDMA_ChannelFree(ch);
+    return done;
+}
+
+// ---------------------------------------------------------------------------
+static void SPIFI_DmaHandler(void* param, UINT32 status)
+{
+    spifi_dma_status |= status;
 }
+#endif
 
 #pragma arm section code = "SectionForFlashOperations"
 // These functions change SPIFI flash and need to be relocated to run
 // from SRAM. Any functions invoked here also need to be in SRAM.
+//
+// Code can't be fetched from SPIFI in command mode, so each erase or page
+// program gets its own command mode window and the flash goes back to memory
+// mode in between. Interrupts stay enabled in the window but the ones with a
+// handler in SPIFI are masked in the NVIC. They stay pending and are taken
+// when the window closes. Handlers in SectionForFlashOperations keep running.
 
 // ---------------------------------------------------------------------------
 BOOL LPC43XX_SPIFI_Driver::Write(void* context, ByteAddress Address,
@@ -95,25 +394,32 @@ BOOL LPC43XX_SPIFI_Driver::Write(void* context, ByteAddress Address,
 {
     NATIVE_PROFILE_PAL_FLASH();
 
+#if LPC43XX_SPIFI_FTL_SIZE > 0
+    // The FTL always preserves the rest of its pages
+    if (SPIFI_FTL_OWNS(Address)) return SPIFI_FTL_Write(Address, NumBytes, pSectorBuff);
+#endif
     // Read-modify-write is used for FAT filesystems only
     if (ReadModifyWrite) return FALSE;
 
-    UINT32* ChipAddress = (UINT32 *)(Address - SPIFI_MEM_BASE);
-    UINT32* EndAddress  = (UINT32 *)(ChipAddress + NumBytes);
-    UINT32* pBuf = (UINT32 *)pSectorBuff;
+    return SPIFI_Program(Address, (const UINT32 *)pSectorBuff, NumBytes);
+}
+
+// ---------------------------------------------------------------------------
+BOOL SPIFI_Program(ByteAddress Address, const UINT32* Data, UINT32 NumBytes)
+{
+    UINT32 ChipAddress = Address - SPIFI_MEM_BASE;
+    UINT32 EndAddress  = ChipAddress + NumBytes;
+    const UINT32* pBuf = Data;
     UINT32 nBytes;
-    
-    SPIFI_SetCmdMode();
 
     while (ChipAddress < EndAddress) {
-        nBytes = SPIFI_SECTOR_SIZE - ((UINT32)ChipAddress % SPIFI_SECTOR_SIZE);
-        if (nBytes > (UINT32)(EndAddress - ChipAddress)) nBytes = (UINT32)(EndAddress - ChipAddress);
+        nBytes = SPIFI_SECTOR_SIZE - (ChipAddress & SPIFI_SECTOR_MASK);
+        if (nBytes > EndAddress - ChipAddress) nBytes = EndAddress - ChipAddress;
         SPIFI_WriteSector(ChipAddress, pBuf, nBytes);
         ChipAddress += nBytes;
-        pBuf += nBytes;
+        pBuf += nBytes / sizeof(UINT32);
     }
 
-    SPIFI_SetMemMode();
     return TRUE;
 }
 
@@ -122,25 +428,71 @@ BOOL LPC43XX_SPIFI_Driver::EraseBlock(void* context, ByteAddress Address)
 {
     NATIVE_PROFILE_HAL_DRIVERS_FLASH();
 
-    UINT8 stat;
+#if LPC43XX_SPIFI_FTL_SIZE > 0
+    if (SPIFI_FTL_OWNS(Address)) return SPIFI_FTL_Trim(Address & ~SPIFI_BLOCK_MASK, SPIFI_BLOCK_SIZE);
+#endif
+    UINT32 addr = (Address - SPIFI_MEM_BASE) & ~SPIFI_BLOCK_MASK; // Start of block relative to base
+    UINT32 sector = addr / SPIFI_SECTOR_SIZE;
+    UINT32 size, cycles = 0, usec, i;
+    UINT8 op;
+
+    // Largest erase the flash has. Without erase suspend each erase is one
+    // window with interrupts from flash masked, so the block goes as 4K
+    // sectors instead: more time in total, but far shorter blackouts.
+    if (!(LPC43XX_SPIFI_RESUME_USEC > 0 && spifi_flash.EraseSuspend) && spifi_flash.EraseOp[0]) {
+        op = spifi_flash.EraseOp[0];
+        size = SPIFI_SECTOR_SIZE;
+    } else if (spifi_flash.EraseOp[2]) {
+        op = spifi_flash.EraseOp[2];
+        size = SPIFI_BLOCK_SIZE;
+    } else if (spifi_flash.EraseOp[1]) {
+        op = spifi_flash.EraseOp[1];
+        size = SPIFI_HALF_BLOCK;
+    } else {
+        op = spifi_flash.EraseOp[0];
+        size = SPIFI_SECTOR_SIZE;
+    }
+    for (i = 0; i < SPIFI_BLOCK_SIZE; i += size)
+        cycles += SPIFI_Erase(addr + i, op);
 
-    SPIFI_SetCmdMode();
+    usec = cycles / (SystemCoreClock / 1000000);
+    if (usec > spifi_flash.EraseUsec) spifi_flash.EraseUsec = usec;
+    for (i = 0; i < SPIFI_BLOCK_SIZE / SPIFI_SECTOR_SIZE; i++) {
+        SPIFI_MAP_SET(sector + i);
+    }
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+BOOL SPIFI_EraseSector(ByteAddress Address)
+{
+    SPIFI_Erase((Address - SPIFI_MEM_BASE) & ~SPIFI_SECTOR_MASK, spifi_flash.EraseOp[0]);
+    SPIFI_MAP_SET((Address - SPIFI_MEM_BASE) / SPIFI_SECTOR_SIZE);
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// One erase in its own window. Returns the cycles the flash was busy.
+static UINT32 SPIFI_Erase(UINT32 Address, UINT8 Opcode)
+{
+    UINT32 cycles;
 
-    LPC_SPIFI->ADDR = (Address - SPIFI_MEM_BASE) & ~SPIFI_BLOCK_MASK; // Start of block relative to base
+    SPIFI_SetCmdMode();
+    LPC_SPIFI->ADDR = Address;
     SPIFI_SendCmd(SPIFI_WRITE_ENABLE);
     SPIFI_SendCmd(SPIFI_WRITE_ENABLE); // Fix
-    SPIFI_SendCmd(SPIFI_ERASE_BLOCK);
-    SPIFI_SendCmd(SPIFI_READ_STATUS);
-    stat = LPC_SPIFI->DATA_BYTE; // status
-
+    SPIFI_SendCmd(SPIFI_CMD(Opcode, CMD_FRAME_13, 0, 0));
+    cycles = SPIFI_WaitErase();
     SPIFI_SetMemMode();
-    return TRUE;
+    return cycles;
 }
 
 // ---------------------------------------------------------------------------
 static void SPIFI_SetCmdMode(void)
 {
+    spifi_primask = __get_PRIMASK();
     __disable_irq();
+    SPIFI_MaskFlashIrqs();
     SCnSCB->ACTLR &= ~2; // Disable Cortex write buffer 
     //LPC_CGU->BASE_CLK[CLK_BASE_SPIFI] = ((1 << 11) | (CLKIN_IRC << 24)); // Change clock to IRC
     if (LPC_SPIFI->STAT & STAT_MCINIT)  // In memory mode?
@@ -149,17 +501,59 @@ static void SPIFI_SetCmdMode(void)
         while (LPC_SPIFI->STAT & STAT_RESET); // Wait for completion
     }
     LPC_SPIFI->IDATA = IDATA_OPCODE; // Disable no-opcode mode
+    __set_PRIMASK(spifi_primask); // SRAM handlers may run from here
 }
 
 // ---------------------------------------------------------------------------
 static void SPIFI_SetMemMode(void)
 {
-    LPC_SPIFI->IDATA = IDATA_NO_OPCODE; // Enable no-opcode mode
-    SPIFI_SendCmd(SPIFI_READ_QUAD);
-    LPC_SPIFI->MCMD = SPIFI_CMD(CMD_READ_QUAD, CMD_FRAME_03, 0x02, (0x03 << 16));
+    int i;
+
+    __disable_irq();
+    LPC_SPIFI->IDATA = spifi_flash.ReadIdata;
+    if (spifi_flash.ReadIdata != IDATA_OPCODE)
+        SPIFI_SendCmd(spifi_flash.ReadCmd); // Enter no-opcode mode
+    LPC_SPIFI->MCMD = spifi_flash.MemCmd;
     //LPC_CGU->BASE_CLK[CLK_BASE_SPIFI] = ((1 << 11) | (CLKIN_IDIVE << 24)); // Restore clock
     SCnSCB->ACTLR |= 2; // Enable Cortex write buffer
-    __enable_irq();
+    for (i = 0; i < SPIFI_NVIC_REGS; i++)
+        NVIC->ISER[i] = spifi_irq_mask[i]; // Pending ones are taken below
+    if (spifi_systick & SPIFI_SYSTICK_ON) SysTick->CTRL |= SysTick_CTRL_TICKINT_Msk;
+    if (spifi_systick & SPIFI_SYSTICK_PEND) SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+    __set_PRIMASK(spifi_primask);
+}
+
+// ---------------------------------------------------------------------------
+// Masks the enabled interrupts whose handler would be fetched from SPIFI.
+// Vectors are in SRAM, see LPC43XX_INTC. SysTick, used by the PC sampler,
+// is held off the same way and a pending tick is taken on the way out.
+static void SPIFI_MaskFlashIrqs(void)
+{
+    UINT32 *vectors = (UINT32 *)SCB->VTOR + 16;
+    UINT32 enabled, mask;
+    int i, n;
+
+    spifi_systick = 0;
+    if ((SysTick->CTRL & SysTick_CTRL_TICKINT_Msk) && SPIFI_IS_FLASH(vectors[SPIFI_SYSTICK_VECTOR - 16])) {
+        SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
+        spifi_systick = SPIFI_SYSTICK_ON;
+        if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+            SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+            spifi_systick |= SPIFI_SYSTICK_PEND;
+        }
+    }
+
+    for (i = 0; i < SPIFI_NVIC_REGS; i++) {
+        enabled = NVIC->ISER[i];
+        mask = 0;
+        for (n = 0; n < 32; n++) {
+            if ((enabled & (1UL << n)) && SPIFI_IS_FLASH(vectors[(i << 5) + n])) mask |= (1UL << n);
+        }
+        NVIC->ICER[i] = mask;
+        spifi_irq_mask[i] = mask;
+    }
+    __DSB();
+    __ISB();
 }
 
 // ---------------------------------------------------------------------------
@@ -170,45 +564,123 @@ static void SPIFI_SendCmd(UINT32 Command)
 }
 
 // ---------------------------------------------------------------------------
-static void SPIFI_WriteSector(UINT32 *dstAddr, UINT32 *srcAddr, UINT32 nBytes)
+// The SPIFI polls the busy bit in hardware, no status round trips from the
+// CPU. Returns the final status.
+static UINT8 SPIFI_WaitReady(void)
+{
+    SPIFI_SendCmd(SPIFI_READ_STATUS);
+    return LPC_SPIFI->DATA_BYTE;
+}
+
+// ---------------------------------------------------------------------------
+// Waits for an erase started in the current command mode window. When an
+// interrupt masked by the window is pending and the erase has run for at
+// least LPC43XX_SPIFI_RESUME_USEC, the erase is suspended and the flash goes
+// back to memory mode so the handler can run, then the erase is resumed.
+// Only on parts with EraseSuspend, and not when the caller has interrupts
+// off, as the handler could not run anyway. Page programs are short and are
+// not suspended. Returns the cycles the erase ran, without the time spent
+// suspended.
+static UINT32 SPIFI_WaitErase(void)
 {
-    UINT32 addr = (UINT32)dstAddr & ~(SPIFI_SECTOR_MASK);
-    UINT32 offset = (UINT32)dstAddr & SPIFI_SECTOR_MASK;
-    UINT32 *pBuf = srcAddr;
-    UINT8 stat;
-    int i, j;
+    UINT32 cycles = LPC43XX_SPIFI_RESUME_USEC * (SystemCoreClock / 1000000);
+    UINT32 start, pending, busy = 0;
+    BOOL suspend = (LPC43XX_SPIFI_RESUME_USEC > 0 && spifi_flash.EraseSuspend && spifi_primask == 0);
+    int i;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    start = DWT->CYCCNT;
+
+    LPC_SPIFI->CMD = SPIFI_READ_STATUS;
+    while (LPC_SPIFI->STAT & STAT_CMD) {
+        if (!suspend || DWT->CYCCNT - start < cycles) continue;
+        for (pending = 0, i = 0; i < SPIFI_NVIC_REGS; i++)
+            pending |= NVIC->ISPR[i] & spifi_irq_mask[i];
+        if (!pending) continue;
+
+        LPC_SPIFI->STAT = STAT_RESET; // Abort the status poll
+        while (LPC_SPIFI->STAT & STAT_RESET);
+        SPIFI_SendCmd(SPIFI_SUSPEND);
+        SPIFI_WaitReady();
+        busy += DWT->CYCCNT - start;
+        SPIFI_SendCmd(SPIFI_READ_STATUS2);
+        if (!(LPC_SPIFI->DATA_BYTE & FLASH_SUS)) return busy; // Done before the suspend
+
+        SPIFI_SetMemMode(); // Pending handlers run here
+        SPIFI_SetCmdMode();
+        SPIFI_SendCmd(SPIFI_RESUME);
+        start = DWT->CYCCNT;
+        LPC_SPIFI->CMD = SPIFI_READ_STATUS;
+    }
+    return busy + (DWT->CYCCNT - start);
+}
 
-    LPC_SPIFI->ADDR = addr;
+// ---------------------------------------------------------------------------
+// Programs SPIFI_PAGE_SIZE bytes, one command per flash page. Parts with
+// smaller pages take several windows.
+static void SPIFI_ProgramPage(UINT32 Address, const UINT32* Data)
+{
+    UINT32 page = spifi_flash.PageSize;
+    UINT32 i, n, start, usec;
 
-    // Read sector into buffer is only updating part of it
-    if (offset != 0 || nBytes < SPIFI_SECTOR_SIZE) {
-        LPC_SPIFI->CMD = SPIFI_READ_BLOCK | SPIFI_SECTOR_SIZE;
-        for(i = 0; i < SPIFI_SECTOR_WORDS; i++)
-            sector_buf[i] = LPC_SPIFI->DATA;
-            //sector_buf[i] = *(volatile UINT32*)&LPC_SPIFI->DATA;
+    SPIFI_MAP_CLEAR(Address / SPIFI_SECTOR_SIZE);
+    for (n = 0; n < SPIFI_PAGE_SIZE; n += page) {
+        SPIFI_SetCmdMode();
+        LPC_SPIFI->ADDR = Address + n;
+        SPIFI_SendCmd(SPIFI_WRITE_ENABLE);
+        LPC_SPIFI->CMD = spifi_flash.ProgCmd | page;
+        for (i = 0; i < page / sizeof(UINT32); i++)
+            LPC_SPIFI->DATA = *Data++;
         while (LPC_SPIFI->STAT & STAT_CMD); // Wait for completion
-        i = (offset + nBytes)/4;
-        for (j = offset/4; j < i; j++)
-            sector_buf[j] = *srcAddr++;
-        pBuf = sector_buf;
+        start = DWT->CYCCNT;
+        SPIFI_WaitReady();
+        usec = (DWT->CYCCNT - start) / (SystemCoreClock / 1000000);
+        SPIFI_SetMemMode();
+        if (usec > spifi_flash.ProgUsec) spifi_flash.ProgUsec = usec;
     }
+}
 
-    // Erase sector
-    SPIFI_SendCmd(SPIFI_WRITE_ENABLE);
-    SPIFI_SendCmd(SPIFI_ERASE_SECTOR);
-    SPIFI_SendCmd(SPIFI_READ_STATUS);
-    stat = LPC_SPIFI->DATA_BYTE; // status
+// ---------------------------------------------------------------------------
+// Compares the new data with the flash first. Nothing is done if it matches,
+// the sector is only erased if some bit has to go from 0 to 1, and only the
+// pages that differ from the flash contents are programmed.
+static void SPIFI_WriteSector(UINT32 dstAddr, const UINT32 *srcAddr, UINT32 nBytes)
+{
+    UINT32 addr = dstAddr & ~(SPIFI_SECTOR_MASK);
+    UINT32 first = (dstAddr & SPIFI_SECTOR_MASK) / 4;
+    UINT32 last = first + nBytes / 4;
+    UINT32 *pMem = (UINT32 *)(SPIFI_MEM_BASE + addr);
+    UINT32 dirty = 0; // One bit per page
+    BOOL erase = FALSE;
+    UINT32 i;
+
+    // Still in memory mode here, the flash is read through the memory map
+    for (i = first; i < last; i++) {
+        if (pMem[i] == srcAddr[i - first]) continue;
+        dirty |= 1 << (i / SPIFI_PAGE_WORDS);
+        if ((pMem[i] & srcAddr[i - first]) != srcAddr[i - first]) erase = TRUE;
+    }
+    if (dirty == 0) return;
 
-    // Program Sector
-    for (i = 0; i < SPIFI_SECTOR_WORDS; i += SPIFI_WRITE_SIZE) {
-        SPIFI_SendCmd(SPIFI_WRITE_ENABLE);
-        LPC_SPIFI->CMD = SPIFI_PROG | (SPIFI_WRITE_SIZE << 2);
-        for (j = 0; j < SPIFI_WRITE_SIZE; j++)
-            LPC_SPIFI->DATA = pBuf[i + j];
-        while (LPC_SPIFI->STAT & 2); // Wait for completion
-        SPIFI_SendCmd(SPIFI_READ_STATUS);
-        stat = LPC_SPIFI->DATA_BYTE; // status
-        LPC_SPIFI->ADDR += (SPIFI_WRITE_SIZE << 2);
+    // Whole sector image, programming a page again with its current contents
+    // leaves the bits outside the update as they are
+    for (i = 0; i < SPIFI_SECTOR_WORDS; i++)
+        sector_buf[i] = (i >= first && i < last) ? srcAddr[i - first] : pMem[i];
+
+    if (erase) {
+        SPIFI_EraseSector(SPIFI_MEM_BASE + addr);
+
+        // Erased pages only need programming if they hold data
+        dirty = 0;
+        for (i = 0; i < SPIFI_SECTOR_WORDS; i++) {
+            if (sector_buf[i] != 0xFFFFFFFF) dirty |= 1 << (i / SPIFI_PAGE_WORDS);
+        }
+    }
+
+    // Program dirty pages, one per window
+    for (i = 0; i < SPIFI_SECTOR_WORDS; i += SPIFI_PAGE_WORDS) {
+        if (dirty & (1 << (i / SPIFI_PAGE_WORDS))) SPIFI_ProgramPage(addr + (i << 2), &sector_buf[i]);
     }
 }
 
@@ -218,19 +690,54 @@ static void SPIFI_WriteSector(UINT32 *dstAddr, UINT32 *srcAddr, UINT32 nBytes)
 BOOL LPC43XX_SPIFI_Driver::IsBlockErased(void* context, ByteAddress BlockStart, UINT32 BlockLength)
 {
     NATIVE_PROFILE_HAL_DRIVERS_FLASH();
-    
-    UINT32* ChipAddress = (UINT32 *) BlockStart;
-    UINT32* EndAddress  = (UINT32 *)(BlockStart + BlockLength);
-    
-    while(ChipAddress < EndAddress)
-    {
-        if(*ChipAddress != (UINT32)-1)
-        {
-            return FALSE;
+#if LPC43XX_SPIFI_FTL_SIZE > 0
+    if (SPIFI_FTL_OWNS(BlockStart)) return SPIFI_FTL_IsErased(BlockStart, BlockLength);
+#endif
+
+    return SPIFI_IsErased(BlockStart, BlockLength);
+}
+
+// ---------------------------------------------------------------------------
+// Sectors marked in the erased map are skipped, whole sectors found blank
+// are marked so later checks don't read them again.
+BOOL SPIFI_IsErased(ByteAddress Address, UINT32 NumBytes)
+{
+    UINT32 offset = Address - SPIFI_MEM_BASE;
+    UINT32 end = offset + NumBytes;
+    UINT32 sector, count;
+
+    if ((Address | NumBytes) & 3) { // Not word aligned, no map
+        const BYTE* p = (const BYTE *)Address;
+        while (NumBytes--) {
+            if (*p++ != 0xFF) return FALSE;
         }
-        ChipAddress++;
+        return TRUE;
     }
 
+    while (offset < end) {
+        sector = offset / SPIFI_SECTOR_SIZE;
+        count = SPIFI_SECTOR_SIZE - (offset & SPIFI_SECTOR_MASK);
+        if (count > end - offset) count = end - offset;
+        if (sector >= SPIFI_MAP_SECTORS || !(spifi_erased[sector >> 5] & SPIFI_MAP_BIT(sector))) {
+            if (!SPIFI_IsBlank((const UINT32 *)(SPIFI_MEM_BASE + offset), count / sizeof(UINT32))) return FALSE;
+            if (count == SPIFI_SECTOR_SIZE) SPIFI_MAP_SET(sector);
+        }
+        offset += count;
+    }
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Eight words per pass like SPIFI_CopyWords, exits on the first pass that
+// finds a programmed bit
+static BOOL SPIFI_IsBlank(const UINT32* p, UINT32 nWords)
+{
+    for (; nWords >= 8; nWords -= 8, p += 8) {
+        if ((p[0] & p[1] & p[2] & p[3] & p[4] & p[5] & p[6] & p[7]) != 0xFFFFFFFF) return FALSE;
+    }
+    while (nWords--) {
+        if (*p++ != 0xFFFFFFFF) return FALSE;
+    }
     return TRUE;
 }
 
@@ -239,21 +746,27 @@ BOOL LPC43XX_SPIFI_Driver::Memset(void* context, ByteAddress Address, UINT8 Data
 {
     NATIVE_PROFILE_PAL_FLASH();
 
-    // ToDo: Implement SPIFI filesystem support
+#if LPC43XX_SPIFI_FTL_SIZE > 0
+    if (SPIFI_FTL_OWNS(Address)) return SPIFI_FTL_Memset(Address, Data, NumBytes);
+#endif
     return FALSE;
 }
 
 // ---------------------------------------------------------------------------
 BOOL LPC43XX_SPIFI_Driver::GetSectorMetadata(void* context, ByteAddress SectorStart, SectorMetadata* pSectorMetadata)
 {
-    // ToDo: Implement SPIFI filesystem support
+#if LPC43XX_SPIFI_FTL_SIZE > 0
+    if (SPIFI_FTL_OWNS(SectorStart)) return SPIFI_FTL_GetMetadata(SectorStart, pSectorMetadata);
+#endif
     return FALSE;
 }
 
 // ---------------------------------------------------------------------------
 BOOL LPC43XX_SPIFI_Driver::SetSectorMetadata(void* context, ByteAddress SectorStart, SectorMetadata* pSectorMetadata)
 {
-    // ToDo: Implement SPIFI filesystem support
+#if LPC43XX_SPIFI_FTL_SIZE > 0
+    if (SPIFI_FTL_OWNS(SectorStart)) return SPIFI_FTL_SetMetadata(SectorStart, pSectorMetadata);
+#endif
     return FALSE;
 }
 
@@ -263,25 +776,57 @@ void LPC43XX_SPIFI_Driver::SetPowerState(void* context, UINT32 State)
 }
 
 // ---------------------------------------------------------------------------
+// Longest page program seen so far, until then the SFDP maximum or the
+// configured value
 UINT32 LPC43XX_SPIFI_Driver::MaxSectorWrite_uSec(void* context)
 {
     NATIVE_PROFILE_PAL_FLASH();
 
     MEMORY_MAPPED_NOR_BLOCK_CONFIG* config = (MEMORY_MAPPED_NOR_BLOCK_CONFIG*)context;
-    
+
+    if (spifi_flash.ProgUsec) return spifi_flash.ProgUsec;
+    if (spifi_flash.ProgMaxUsec) return spifi_flash.ProgMaxUsec;
     return config->BlockConfig.BlockDeviceInformation->MaxSectorWrite_uSec;
 }
 
 // ---------------------------------------------------------------------------
+// Same for a 64K block erase
 UINT32 LPC43XX_SPIFI_Driver::MaxBlockErase_uSec(void* context)
 {
     NATIVE_PROFILE_PAL_FLASH();
     
     MEMORY_MAPPED_NOR_BLOCK_CONFIG* config = (MEMORY_MAPPED_NOR_BLOCK_CONFIG*)context;
 
+    if (spifi_flash.EraseUsec) return spifi_flash.EraseUsec;
+    if (spifi_flash.EraseMaxUsec) return spifi_flash.EraseMaxUsec;
     return config->BlockConfig.BlockDeviceInformation->MaxBlockErase_uSec;
 }
 
+// ---------------------------------------------------------------------------
+const SPIFI_FLASH_INFO* SPIFI_GetFlashInfo(void)
+{
+    return &spifi_flash;
+}
+
+// ---------------------------------------------------------------------------
+// Memory mapped read speed in KB/s, timed with the cycle counter. Uses the
+// CPU copy, reads stay below the DMA threshold.
+UINT32 SPIFI_ReadKBps(ByteAddress Address, UINT32 NumBytes)
+{
+    UINT32 buf[64];
+    UINT32 start, cycles, done, n;
+
+    start = DWT->CYCCNT;
+    for (done = 0; done < NumBytes; done += n) {
+        n = NumBytes - done;
+        if (n > sizeof(buf)) n = sizeof(buf);
+        SPIFI_Copy((BYTE *)buf, Address + done, n);
+    }
+    cycles = DWT->CYCCNT - start;
+
+    return cycles ? (UINT32)((UINT64)NumBytes * SystemCoreClock / 1024 / cycles) : 0;
+}
+
 #if defined(ADS_LINKER_BUG__NOT_ALL_UNUSED_VARIABLES_ARE_REMOVED)
 #pragma arm section rodata = "g_LPC43XX_SPIFI_DeviceTable"
 #endif
@@ -25,15 +25,22 @@
 // Command opcodes
 #define CMD_ERASE_SECT    0x20
 #define CMD_ERASE_BLOCK   0xD8
+#define CMD_ERASE_HALF    0x52  // 32K block
 #define CMD_ERASE_CHIP    0xC7
 #define CMD_PROG          0x02
 #define CMD_PROG_QUAD     0x32
+#define CMD_PROG_4PP      0x38  // Macronix quad address and data
 #define CMD_PROT_SECT     0x36
 #define CMD_READ          0x03
+#define CMD_READ_FAST     0x0B
 #define CMD_READ_ID       0x9F
 #define CMD_READ_STAT     0x05
+#define CMD_READ_STAT2    0x35
 #define CMD_READ_QUAD     0xEB
+#define CMD_READ_SFDP     0x5A
 #define CMD_RESET         0xFF  // Exit QPI
+#define CMD_RESUME        0x7A  // Erase/program resume
+#define CMD_SUSPEND       0x75  // Erase/program suspend
 #define CMD_UNPROT_SECT   0x39
 #define CMD_WRITE_DIS     0x04
 #define CMD_WRITE_EN      0x06
@@ -52,6 +59,11 @@
 #define CMD_POLL          (1 << 14)
 #define CMD_OUTPUT        (1 << 15)
 
+// Poll commands end when status bit number bit reads val
+#define POLL_BIT(bit, val)  ((bit) | ((val) << 3))
+#define FLASH_BUSY_BIT    0     // Flash status register 1 busy bit
+#define FLASH_SUS         0x80  // Flash status register 2 suspended flag (Winbond)
+
 // Encoding for SPIFI command register
 #define SPIFI_CMD(op, frm, fld, opt)  (((UINT32)op << 24) | (frm << 21) | (fld << 19) | opt)
 
@@ -59,14 +71,25 @@
 #define SPIFI_ERASE_BLOCK   SPIFI_CMD(CMD_ERASE_BLOCK, CMD_FRAME_13, 0, 0)
 #define SPIFI_ERASE_CHIP    SPIFI_CMD(CMD_ERASE_CHIP,  CMD_FRAME_13, 0, 0)
 #define SPIFI_ERASE_SECTOR  SPIFI_CMD(CMD_ERASE_SECT,  CMD_FRAME_13, 0, 0)
-#define SPIFI_PROG          SPIFI_CMD(CMD_PROG_QUAD,   CMD_FRAME_13, 1, CMD_OUTPUT) // OR with write size
+#define SPIFI_PROG          SPIFI_CMD(CMD_PROG_QUAD,   CMD_FRAME_13, 1, CMD_OUTPUT) // Quad data, OR with write size
+#define SPIFI_PROG_4PP      SPIFI_CMD(CMD_PROG_4PP,    CMD_FRAME_13, 2, CMD_OUTPUT) // Quad address and data
+#define SPIFI_PROG_SERIAL   SPIFI_CMD(CMD_PROG,        CMD_FRAME_13, 0, CMD_OUTPUT)
 #define SPIFI_READ_BLOCK    SPIFI_CMD(CMD_READ_QUAD,   CMD_FRAME_03, 2, (3 << 16))  // OR with block size
-#define SPIFI_READ_ID       SPIFI_CMD(CMD_READ_ID,     CMD_FRAME_10, 0, 0)
+#define SPIFI_READ_FAST     SPIFI_CMD(CMD_READ_FAST,   CMD_FRAME_13, 0, (1 << 16))
+#define SPIFI_READ_ID       SPIFI_CMD(CMD_READ_ID,     CMD_FRAME_10, 0, 0)  // OR with 3
 #define SPIFI_READ_QUAD     SPIFI_CMD(CMD_READ_QUAD,   CMD_FRAME_13, 2, (3 << 16))
-#define SPIFI_READ_STATUS   SPIFI_CMD(CMD_READ_STAT,   CMD_FRAME_10, 0, CMD_POLL)
+#define SPIFI_READ_SFDP     SPIFI_CMD(CMD_READ_SFDP,   CMD_FRAME_13, 0, (1 << 16))  // OR with read size
+#define SPIFI_READ_STATUS   SPIFI_CMD(CMD_READ_STAT,   CMD_FRAME_10, 0, CMD_POLL | POLL_BIT(FLASH_BUSY_BIT, 0))
+#define SPIFI_READ_STATUS2  SPIFI_CMD(CMD_READ_STAT2,  CMD_FRAME_10, 0, 1)
+#define SPIFI_RESUME        SPIFI_CMD(CMD_RESUME,      CMD_FRAME_10, 0, 0)
+#define SPIFI_SUSPEND       SPIFI_CMD(CMD_SUSPEND,     CMD_FRAME_10, 0, 0)
 #define SPIFI_RESET         SPIFI_CMD(CMD_RESET,       CMD_FRAME_14, 0, (4 << 16))
 #define SPIFI_WRITE_ENABLE  SPIFI_CMD(CMD_WRITE_EN,    CMD_FRAME_10, 0, 0)
             
+// Control register read sampling
+#define CTRL_RFCLK        (1 << 29)  // Falling edge
+#define CTRL_FBCLK        (1 << 30)  // Feedback clock
+
 // Status flags
 #define STAT_MCINIT       (1 << 0)
 #define STAT_CMD          (1 << 1)
@@ -78,6 +101,26 @@
 
 #endif // USE_SPIFI_LIB
 
+// Flash parameters. ChipInitialize reads the JEDEC ID and the SFDP tables,
+// parts without them keep the W25Q32FV settings.
+typedef struct
+{
+  UINT32 JedecId;       // Manufacturer in bits 16-23, device in bits 0-15
+  UINT32 Size;          // Bytes, up to the 16M reached by 3 byte addresses
+  UINT32 PageSize;      // Program page, up to 256
+  UINT8 EraseOp[3];     // 4K, 32K and 64K erase opcodes, 0 if not supported
+  UINT32 ReadCmd;       // Fastest read, with opcode
+  UINT32 MemCmd;        // Read in memory mode, no opcode in continuous mode
+  UINT32 ReadIdata;     // Mode bits, IDATA_OPCODE unless continuous
+  UINT32 ProgCmd;       // Page program, OR with the size
+  UINT32 ProgMaxUsec;   // Page program and 64K erase maximum from SFDP,
+  UINT32 EraseMaxUsec;  // 0 if not given
+  UINT32 ProgUsec;      // Longest page program and 64K erase measured,
+  UINT32 EraseUsec;     // 0 until the first one
+  UINT32 ClockKHz;      // SPIFI clock as set up by the bootstrap
+  BOOL EraseSuspend;    // Erases may be suspended, SUS in status register 2
+} SPIFI_FLASH_INFO;
+
 struct LPC43XX_SPIFI_Driver
 {
     static BOOL ChipInitialize(void* context);
@@ -97,4 +140,46 @@ struct LPC43XX_SPIFI_Driver
     static BOOL ReadProductID(void* context, FLASH_WORD& ManufacturerCode, FLASH_WORD& DeviceCode);
 };
 
+// Raw access below the block storage entry points. Program compares with the
+// flash and only erases when a bit has to go from 0 to 1. Address and
+// NumBytes are multiples of 4, Data must not be in SPIFI.
+BOOL SPIFI_Program(ByteAddress Address, const UINT32* Data, UINT32 NumBytes);
+BOOL SPIFI_EraseSector(ByteAddress Address);
+const SPIFI_FLASH_INFO* SPIFI_GetFlashInfo(void);
+// Memory mapped read speed over NumBytes from Address
+UINT32 SPIFI_ReadKBps(ByteAddress Address, UINT32 NumBytes);
+// Reads through the memory map, any alignment
+void SPIFI_Copy(BYTE* Dst, ByteAddress Src, UINT32 NumBytes);
+// Remembers the sectors found or made blank until they are programmed
+BOOL SPIFI_IsErased(ByteAddress Address, UINT32 NumBytes);
+
+#if LPC43XX_SPIFI_FTL_SIZE > 0
+// Flash translation layer. LPC43XX_SPIFI_FTL_LOGICAL bytes from
+// LPC43XX_SPIFI_FTL_BASE are a wear leveled log of 512 byte pages kept in
+// LPC43XX_SPIFI_FTL_SIZE bytes of flash. The region is not XIP, it is only
+// reached through these, so boards give it its own block storage device with
+// SupportsXIP FALSE. Mounted on first use, a region holding data from before
+// the FTL mounts empty and is reformatted by the file system.
+#define SPIFI_FTL_OWNS(a)  ((a) >= LPC43XX_SPIFI_FTL_BASE && (a) < LPC43XX_SPIFI_FTL_BASE + LPC43XX_SPIFI_FTL_LOGICAL)
+
+// Mount result
+#define SPIFI_FTL_UNMOUNTED  0
+#define SPIFI_FTL_MOUNTED    1  // Log found
+#define SPIFI_FTL_EMPTY      2  // No segment found, blank or older contents
+#define SPIFI_FTL_FAILED     3  // Region too small, out of memory or flash error
+
+// Mounts the FTL if needed and returns its state
+INT32 SPIFI_FTL_Status(void);
+
+BOOL SPIFI_FTL_Read(ByteAddress Address, UINT32 NumBytes, BYTE* Buffer);
+BOOL SPIFI_FTL_Write(ByteAddress Address, UINT32 NumBytes, const BYTE* Buffer);
+BOOL SPIFI_FTL_Memset(ByteAddress Address, UINT8 Data, UINT32 NumBytes);
+// Drops the whole pages in the range, they read as erased
+BOOL SPIFI_FTL_Trim(ByteAddress Address, UINT32 NumBytes);
+BOOL SPIFI_FTL_IsErased(ByteAddress Address, UINT32 NumBytes);
+// Metadata of the page holding Address
+BOOL SPIFI_FTL_GetMetadata(ByteAddress Address, SectorMetadata* Metadata);
+BOOL SPIFI_FTL_SetMetadata(ByteAddress Address, const SectorMetadata* Metadata);
+#endif
+
 #endif // _LPC43XX_SPIFI_H_
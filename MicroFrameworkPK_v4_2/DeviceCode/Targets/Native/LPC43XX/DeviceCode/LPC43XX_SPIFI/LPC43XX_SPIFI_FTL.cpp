@@ -0,0 +1,548 @@
+////////////////////////////////////////////////////////////////////////////////
+// LPC43XX_SPIFI_FTL.cpp - SPIFI flash translation layer for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+
+#include <tinyhal.h>
+#include "LPC43XX.h"
+
+#include "LPC43XX_SPIFI.h"
+
+#if LPC43XX_SPIFI_FTL_SIZE > 0
+
+// The region is a log of 512 byte logical pages. Each 4K flash sector is a
+// segment: a header page with one record per slot, then 7 data slots. A page
+// update goes to the next slot of the active segment and the old copy is
+// marked obsolete. Garbage collection moves the live pages out of the
+// segment with the fewest and erases it. The map from page to slot is
+// rebuilt from the records at mount and kept in RAM.
+//
+// An update commits when its record is programmed, after the data. Records
+// carry a check so a partly programmed one is ignored. If power fails before
+// the old copy is marked obsolete the copy in the newer segment wins.
+//
+// Data written in place before the FTL was enabled is not migrated. A region
+// without any segment mounts empty, the file system finds blank media and
+// formats it, and the old sectors are erased as segments are opened.
+//
+// Collection fills a free segment before it erases the victim. Power lost in
+// between leaves the victim closed with its pages superseded, and the free
+// segment gone until the next collection. Two free segments are kept so that
+// collection still has one to move pages into.
+
+#define FTL_SEGMENT_SIZE    4096
+#define FTL_PAGE_SIZE       512
+#define FTL_SLOTS           7           // Data slots per segment
+#define FTL_DATA_OFFSET     256         // Header page, then the slots
+#define FTL_MAGIC           0x4C54465F  // "_FTL"
+#define FTL_FREE            0xFFFF      // Unmapped page
+#define FTL_RESERVE         2           // Free segments kept for collection
+#define FTL_STALE_MAX       16          // Obsolete marks batched per flush
+#define FTL_WEAR_INTERVAL   32          // Erases between static wear leveling
+#define FTL_WEAR_SPREAD     16          // Erase count spread that triggers it
+
+#define FTL_SEGMENTS        (LPC43XX_SPIFI_FTL_SIZE / FTL_SEGMENT_SIZE)
+#define FTL_PAGES           (LPC43XX_SPIFI_FTL_LOGICAL / FTL_PAGE_SIZE)
+#define FTL_META_SIZE       ((sizeof(SectorMetadata) < 8) ? sizeof(SectorMetadata) : 8)
+
+typedef struct
+{
+  UINT32 tag;       // Page and check, FFFFFFFF while free
+  UINT32 meta[2];   // SectorMetadata
+  UINT32 obsolete;  // Cleared when superseded
+} FTL_RECORD_T;
+
+typedef struct
+{
+  UINT32 magic;     // Programmed last
+  UINT32 seq;       // Order of segments in the log
+  UINT32 erases;
+  UINT32 reserved;
+  FTL_RECORD_T rec[FTL_SLOTS];
+} FTL_HEADER_T;
+
+// Segment states
+#define FTL_SEG_FREE    0
+#define FTL_SEG_ACTIVE  1
+#define FTL_SEG_CLOSED  2
+
+typedef struct
+{
+  UINT32 seq;
+  UINT32 erases;
+  UINT8 state;
+  UINT8 used;       // Slots taken
+  UINT8 live;       // Slots holding the current copy of a page
+} FTL_SEGMENT_T;
+
+#define FTL_HEADER(s)     ((const FTL_HEADER_T *)(LPC43XX_SPIFI_FTL_BASE + (s) * FTL_SEGMENT_SIZE))
+#define FTL_SLOT(i)       ((const BYTE *)LPC43XX_SPIFI_FTL_BASE + ((i) / FTL_SLOTS) * FTL_SEGMENT_SIZE + \
+                           FTL_DATA_OFFSET + ((i) % FTL_SLOTS) * FTL_PAGE_SIZE)
+
+static UINT16* ftl_map;                 // Page to slot, segment * FTL_SLOTS + n
+static FTL_SEGMENT_T* ftl_seg;
+static FTL_RECORD_T ftl_rec[FTL_SLOTS]; // Records of the active segment
+static UINT16 ftl_stale[FTL_STALE_MAX]; // Slots to mark obsolete
+static INT32 ftl_nstale;
+static INT32 ftl_active;
+static INT32 ftl_free;                  // Free segments
+static UINT32 ftl_seq;
+static UINT32 ftl_erases;               // Erases since the last wear leveling
+static INT32 ftl_status;                // SPIFI_FTL_*
+static UINT32 ftl_buf[FTL_PAGE_SIZE / sizeof(UINT32)];
+
+static BOOL FTL_Collect(void);
+
+// ---------------------------------------------------------------------------
+static UINT32 FTL_Check(UINT32 Page, const UINT32* Meta)
+{
+    UINT32 sum = Page + (Meta[0] & 0xFFFF) + (Meta[0] >> 16) + (Meta[1] & 0xFFFF) + (Meta[1] >> 16);
+
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return ~(sum + (sum >> 16)) & 0xFFFF;
+}
+
+// ---------------------------------------------------------------------------
+static BOOL FTL_RecordPage(const FTL_RECORD_T* Rec, UINT32& Page)
+{
+    Page = Rec->tag & 0xFFFF;
+    return Page < FTL_PAGES && (Rec->tag >> 16) == FTL_Check(Page, Rec->meta);
+}
+
+// ---------------------------------------------------------------------------
+// Records of the active segment are in RAM until they are flushed
+static const FTL_RECORD_T* FTL_Record(UINT32 Slot)
+{
+    UINT32 s = Slot / FTL_SLOTS;
+
+    return ((INT32)s == ftl_active) ? &ftl_rec[Slot % FTL_SLOTS] : &FTL_HEADER(s)->rec[Slot % FTL_SLOTS];
+}
+
+// ---------------------------------------------------------------------------
+// Commits the records of the active segment, then marks the stale slots
+// obsolete with one program per segment
+static BOOL FTL_Flush(void)
+{
+    FTL_RECORD_T rec[FTL_SLOTS];
+    FTL_RECORD_T* img;
+    INT32 s, i, j;
+
+    if (ftl_active >= 0 &&
+        !SPIFI_Program((ByteAddress)FTL_HEADER(ftl_active)->rec, (const UINT32 *)ftl_rec, sizeof(ftl_rec)))
+        return FALSE;
+
+    while (ftl_nstale > 0) {
+        s = ftl_stale[0] / FTL_SLOTS;
+        img = (s == ftl_active) ? ftl_rec : rec;
+        if (img == rec) memcpy(rec, FTL_HEADER(s)->rec, sizeof(rec));
+        for (i = j = 0; i < ftl_nstale; i++) {
+            if (ftl_stale[i] / FTL_SLOTS == s) img[ftl_stale[i] % FTL_SLOTS].obsolete = 0;
+            else ftl_stale[j++] = ftl_stale[i];
+        }
+        ftl_nstale = j;
+        if (!SPIFI_Program((ByteAddress)FTL_HEADER(s)->rec, (const UINT32 *)img, sizeof(rec))) return FALSE;
+    }
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+static BOOL FTL_Stale(UINT32 Slot)
+{
+    if (ftl_nstale == FTL_STALE_MAX && !FTL_Flush()) return FALSE;
+    ftl_stale[ftl_nstale++] = Slot;
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Opens the least worn free segment as the active one
+static BOOL FTL_Open(void)
+{
+    UINT32 head[2];
+    const UINT32* p;
+    INT32 s, best = -1;
+
+    for (s = 0; s < FTL_SEGMENTS; s++) {
+        if (ftl_seg[s].state != FTL_SEG_FREE) continue;
+        if (best < 0 || ftl_seg[s].erases < ftl_seg[best].erases) best = s;
+    }
+    if (best < 0) return FALSE;
+
+    // Segments never used or cut short by a power failure need an erase
+    p = (const UINT32 *)FTL_HEADER(best);
+    if (!SPIFI_IsErased((ByteAddress)p, FTL_SEGMENT_SIZE)) {
+        if (!SPIFI_EraseSector((ByteAddress)p)) return FALSE;
+        ftl_seg[best].erases++;
+        ftl_erases++;
+    }
+
+    // The segment is part of the log once the magic is programmed
+    head[0] = ++ftl_seq;
+    head[1] = ftl_seg[best].erases;
+    if (!SPIFI_Program((ByteAddress)&FTL_HEADER(best)->seq, head, sizeof(head))) return FALSE;
+    head[0] = FTL_MAGIC;
+    if (!SPIFI_Program((ByteAddress)&FTL_HEADER(best)->magic, head, sizeof(UINT32))) return FALSE;
+
+    ftl_seg[best].state = FTL_SEG_ACTIVE;
+    ftl_seg[best].seq = ftl_seq;
+    ftl_seg[best].used = 0;
+    ftl_seg[best].live = 0;
+    ftl_free--;
+    ftl_active = best;
+    memset(ftl_rec, 0xFF, sizeof(ftl_rec));
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Next slot of the active segment. A full segment is flushed and closed
+// before the next one is opened, collecting first unless Collecting.
+static INT32 FTL_Alloc(BOOL Collecting)
+{
+    while (ftl_active < 0 || ftl_seg[ftl_active].used == FTL_SLOTS) {
+        if (!FTL_Flush()) return -1;
+        if (ftl_active >= 0) ftl_seg[ftl_active].state = FTL_SEG_CLOSED;
+        ftl_active = -1;
+        if (!Collecting && ftl_free <= FTL_RESERVE) {
+            if (!FTL_Collect()) return -1;
+            continue; // Collection may leave an active segment with room
+        }
+        if (!FTL_Open()) return -1;
+    }
+    return ftl_active * FTL_SLOTS + ftl_seg[ftl_active].used++;
+}
+
+// ---------------------------------------------------------------------------
+// Copies a live page to the active segment
+static BOOL FTL_Move(UINT32 Page)
+{
+    INT32 slot = FTL_Alloc(TRUE);
+    UINT32 old = ftl_map[Page];
+
+    if (slot < 0) return FALSE;
+    memcpy(ftl_buf, FTL_SLOT(old), FTL_PAGE_SIZE);
+    if (!SPIFI_Program((ByteAddress)FTL_SLOT(slot), ftl_buf, FTL_PAGE_SIZE)) return FALSE;
+    ftl_rec[slot % FTL_SLOTS] = *FTL_Record(old);
+    ftl_rec[slot % FTL_SLOTS].obsolete = 0xFFFFFFFF;
+    ftl_map[Page] = slot;
+    ftl_seg[old / FTL_SLOTS].live--;
+    ftl_seg[slot / FTL_SLOTS].live++;
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Reclaims the closed segment with the fewest live pages. Every
+// FTL_WEAR_INTERVAL erases the least worn one is taken instead if the wear
+// has spread, so static data moves onto worn flash.
+static BOOL FTL_Collect(void)
+{
+    INT32 s, victim = -1, coldest = -1;
+    UINT32 n, page, hottest = 0;
+
+    for (s = 0; s < FTL_SEGMENTS; s++) {
+        if (ftl_seg[s].state != FTL_SEG_CLOSED) continue;
+        if (victim < 0 || ftl_seg[s].live < ftl_seg[victim].live ||
+            (ftl_seg[s].live == ftl_seg[victim].live && ftl_seg[s].erases < ftl_seg[victim].erases)) victim = s;
+        if (coldest < 0 || ftl_seg[s].erases < ftl_seg[coldest].erases) coldest = s;
+        if (ftl_seg[s].erases > hottest) hottest = ftl_seg[s].erases;
+    }
+    if (victim < 0) return FALSE;
+    if (ftl_erases >= FTL_WEAR_INTERVAL) {
+        ftl_erases = 0;
+        if (hottest - ftl_seg[coldest].erases > FTL_WEAR_SPREAD) victim = coldest;
+    }
+    else if (ftl_seg[victim].live == FTL_SLOTS) {
+        return FALSE; // Full
+    }
+
+    for (n = 0; n < FTL_SLOTS; n++) {
+        if (!FTL_RecordPage(&FTL_HEADER(victim)->rec[n], page) || ftl_map[page] != victim * FTL_SLOTS + n) continue;
+        if (!FTL_Move(page)) return FALSE;
+    }
+
+    // The copies are committed before the originals go
+    if (!FTL_Flush() || !SPIFI_EraseSector((ByteAddress)FTL_HEADER(victim))) return FALSE;
+    ftl_seg[victim].state = FTL_SEG_FREE;
+    ftl_seg[victim].erases++;
+    ftl_erases++;
+    ftl_free++;
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Rebuilds the map from the records. Segments found in use are closed, new
+// pages go to a freshly opened one.
+static BOOL FTL_Mount(void)
+{
+    const FTL_HEADER_T* hdr;
+    FTL_SEGMENT_T* seg;
+    UINT32 s, n, page, slot, old, erases = 0, known = 0;
+
+    if (ftl_status == SPIFI_FTL_MOUNTED || ftl_status == SPIFI_FTL_EMPTY) return TRUE;
+    ftl_status = SPIFI_FTL_FAILED;
+    if (FTL_PAGES > (FTL_SEGMENTS - FTL_RESERVE - 1) * FTL_SLOTS || FTL_SEGMENTS * FTL_SLOTS >= FTL_FREE)
+        return FALSE;
+
+    if (ftl_map == NULL) ftl_map = (UINT16 *)private_malloc(FTL_PAGES * sizeof(UINT16));
+    if (ftl_seg == NULL) ftl_seg = (FTL_SEGMENT_T *)private_malloc(FTL_SEGMENTS * sizeof(FTL_SEGMENT_T));
+    if (ftl_map == NULL || ftl_seg == NULL) return FALSE;
+
+    memset(ftl_map, 0xFF, FTL_PAGES * sizeof(UINT16));
+    ftl_active = -1;
+    ftl_free = 0;
+    ftl_seq = 0;
+    ftl_nstale = 0;
+    ftl_erases = 0;
+
+    for (s = 0; s < FTL_SEGMENTS; s++) {
+        hdr = FTL_HEADER(s);
+        seg = &ftl_seg[s];
+        seg->used = FTL_SLOTS;
+        seg->live = 0;
+        if (hdr->magic != FTL_MAGIC) {
+            seg->state = FTL_SEG_FREE;
+            seg->seq = 0;
+            seg->erases = 0xFFFFFFFF; // Unknown, set below
+            ftl_free++;
+            continue;
+        }
+        seg->state = FTL_SEG_CLOSED;
+        seg->seq = hdr->seq;
+        seg->erases = hdr->erases;
+        if (seg->seq > ftl_seq) ftl_seq = seg->seq;
+        erases += seg->erases;
+        known++;
+
+        for (n = 0; n < FTL_SLOTS; n++) {
+            if (hdr->rec[n].obsolete != 0xFFFFFFFF || !FTL_RecordPage(&hdr->rec[n], page)) continue;
+            slot = s * FTL_SLOTS + n;
+            old = ftl_map[page];
+            if (old != FTL_FREE) {
+                // Power failed before the old copy was marked obsolete
+                if (ftl_seg[old / FTL_SLOTS].seq > seg->seq) {
+                    if (!FTL_Stale(slot)) return FALSE;
+                    continue;
+                }
+                ftl_seg[old / FTL_SLOTS].live--;
+                if (!FTL_Stale(old)) return FALSE;
+            }
+            ftl_map[page] = slot;
+            seg->live++;
+        }
+    }
+
+    // Erase counts lost with a header are taken as the average
+    erases = known ? erases / known : 0;
+    for (s = 0; s < FTL_SEGMENTS; s++) {
+        if (ftl_seg[s].erases == 0xFFFFFFFF) ftl_seg[s].erases = erases;
+    }
+
+    if (!FTL_Flush()) return FALSE;
+    ftl_status = known ? SPIFI_FTL_MOUNTED : SPIFI_FTL_EMPTY;
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Updates Count bytes at Pos of a page from Data, or with Fill if Data is
+// NULL. Meta replaces the metadata if not NULL. The rest of the page and the
+// metadata carry over to the new copy.
+static BOOL FTL_Put(UINT32 Page, UINT32 Pos, UINT32 Count, const BYTE* Data, UINT8 Fill, const UINT32* Meta)
+{
+    const FTL_RECORD_T* cur;
+    const BYTE* src;
+    FTL_RECORD_T rec;
+    UINT32 i, old = ftl_map[Page];
+    INT32 slot;
+
+    // Nothing to do if the page already holds the data
+    if (Meta == NULL) {
+        src = (old == FTL_FREE) ? NULL : FTL_SLOT(old) + Pos;
+        for (i = 0; i < Count; i++) {
+            if ((src ? src[i] : 0xFF) != (Data ? Data[i] : Fill)) break;
+        }
+        if (i == Count) return TRUE;
+    }
+
+    // Collection may move the current copy
+    slot = FTL_Alloc(FALSE);
+    if (slot < 0) return FALSE;
+    old = ftl_map[Page];
+
+    if (old == FTL_FREE) {
+        memset(ftl_buf, 0xFF, FTL_PAGE_SIZE);
+        rec.meta[0] = rec.meta[1] = 0xFFFFFFFF;
+    }
+    else {
+        memcpy(ftl_buf, FTL_SLOT(old), FTL_PAGE_SIZE);
+        cur = FTL_Record(old);
+        rec.meta[0] = cur->meta[0];
+        rec.meta[1] = cur->meta[1];
+    }
+    if (Data) memcpy((BYTE *)ftl_buf + Pos, Data, Count);
+    else memset((BYTE *)ftl_buf + Pos, Fill, Count);
+    if (Meta) {
+        rec.meta[0] = Meta[0];
+        rec.meta[1] = Meta[1];
+    }
+    rec.tag = Page | (FTL_Check(Page, rec.meta) << 16);
+    rec.obsolete = 0xFFFFFFFF;
+
+    // Data first, the record commits it on the next flush
+    if (!SPIFI_Program((ByteAddress)FTL_SLOT(slot), ftl_buf, FTL_PAGE_SIZE)) return FALSE;
+    ftl_rec[slot % FTL_SLOTS] = rec;
+    ftl_map[Page] = slot;
+    ftl_seg[slot / FTL_SLOTS].live++;
+    if (old != FTL_FREE) {
+        ftl_seg[old / FTL_SLOTS].live--;
+        if (!FTL_Stale(old)) return FALSE;
+    }
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+static BOOL FTL_Update(ByteAddress Address, UINT32 NumBytes, const BYTE* Data, UINT8 Fill)
+{
+    UINT32 offset = Address - LPC43XX_SPIFI_FTL_BASE;
+    UINT32 pos, count;
+
+    if (!FTL_Mount() || offset + NumBytes > LPC43XX_SPIFI_FTL_LOGICAL) return FALSE;
+
+    while (NumBytes > 0) {
+        pos = offset % FTL_PAGE_SIZE;
+        count = FTL_PAGE_SIZE - pos;
+        if (count > NumBytes) count = NumBytes;
+        if (!FTL_Put(offset / FTL_PAGE_SIZE, pos, count, Data, Fill, NULL)) return FALSE;
+        if (Data) Data += count;
+        offset += count;
+        NumBytes -= count;
+    }
+    return FTL_Flush();
+}
+
+// ---------------------------------------------------------------------------
+INT32 SPIFI_FTL_Status(void)
+{
+    FTL_Mount();
+    return ftl_status;
+}
+
+// ---------------------------------------------------------------------------
+BOOL SPIFI_FTL_Read(ByteAddress Address, UINT32 NumBytes, BYTE* Buffer)
+{
+    UINT32 offset = Address - LPC43XX_SPIFI_FTL_BASE;
+    UINT32 pos, count, slot;
+
+    if (!FTL_Mount() || offset + NumBytes > LPC43XX_SPIFI_FTL_LOGICAL) return FALSE;
+
+    while (NumBytes > 0) {
+        pos = offset % FTL_PAGE_SIZE;
+        count = FTL_PAGE_SIZE - pos;
+        if (count > NumBytes) count = NumBytes;
+        slot = ftl_map[offset / FTL_PAGE_SIZE];
+        if (slot == FTL_FREE) memset(Buffer, 0xFF, count);
+        else SPIFI_Copy(Buffer, (ByteAddress)(FTL_SLOT(slot) + pos), count);
+        Buffer += count;
+        offset += count;
+        NumBytes -= count;
+    }
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+BOOL SPIFI_FTL_Write(ByteAddress Address, UINT32 NumBytes, const BYTE* Buffer)
+{
+    return FTL_Update(Address, NumBytes, Buffer, 0);
+}
+
+// ---------------------------------------------------------------------------
+BOOL SPIFI_FTL_Memset(ByteAddress Address, UINT8 Data, UINT32 NumBytes)
+{
+    return FTL_Update(Address, NumBytes, NULL, Data);
+}
+
+// ---------------------------------------------------------------------------
+BOOL SPIFI_FTL_Trim(ByteAddress Address, UINT32 NumBytes)
+{
+    UINT32 offset = Address - LPC43XX_SPIFI_FTL_BASE;
+    UINT32 page, last, slot;
+
+    if (!FTL_Mount() || offset + NumBytes > LPC43XX_SPIFI_FTL_LOGICAL) return FALSE;
+
+    last = (offset + NumBytes) / FTL_PAGE_SIZE;
+    for (page = (offset + FTL_PAGE_SIZE - 1) / FTL_PAGE_SIZE; page < last; page++) {
+        slot = ftl_map[page];
+        if (slot == FTL_FREE) continue;
+        ftl_map[page] = FTL_FREE;
+        ftl_seg[slot / FTL_SLOTS].live--;
+        if (!FTL_Stale(slot)) return FALSE;
+    }
+    return FTL_Flush();
+}
+
+// ---------------------------------------------------------------------------
+BOOL SPIFI_FTL_IsErased(ByteAddress Address, UINT32 NumBytes)
+{
+    UINT32 offset = Address - LPC43XX_SPIFI_FTL_BASE;
+    UINT32 pos, count, slot, i;
+    const BYTE* p;
+
+    if (!FTL_Mount() || offset + NumBytes > LPC43XX_SPIFI_FTL_LOGICAL) return FALSE;
+
+    while (NumBytes > 0) {
+        pos = offset % FTL_PAGE_SIZE;
+        count = FTL_PAGE_SIZE - pos;
+        if (count > NumBytes) count = NumBytes;
+        slot = ftl_map[offset / FTL_PAGE_SIZE];
+        if (slot != FTL_FREE) {
+            p = FTL_SLOT(slot) + pos;
+            for (i = 0; i < count; i++) {
+                if (p[i] != 0xFF) return FALSE;
+            }
+        }
+        offset += count;
+        NumBytes -= count;
+    }
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+BOOL SPIFI_FTL_GetMetadata(ByteAddress Address, SectorMetadata* Metadata)
+{
+    UINT32 offset = Address - LPC43XX_SPIFI_FTL_BASE;
+    UINT32 slot;
+
+    if (!FTL_Mount() || offset >= LPC43XX_SPIFI_FTL_LOGICAL) return FALSE;
+
+    slot = ftl_map[offset / FTL_PAGE_SIZE];
+    memset(Metadata, 0xFF, sizeof(SectorMetadata));
+    if (slot != FTL_FREE) memcpy(Metadata, FTL_Record(slot)->meta, FTL_META_SIZE);
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Metadata is part of the record, changing it writes a new copy of the page
+BOOL SPIFI_FTL_SetMetadata(ByteAddress Address, const SectorMetadata* Metadata)
+{
+    UINT32 offset = Address - LPC43XX_SPIFI_FTL_BASE;
+    UINT32 meta[2];
+
+    if (!FTL_Mount() || offset >= LPC43XX_SPIFI_FTL_LOGICAL) return FALSE;
+
+    memset(meta, 0xFF, sizeof(meta));
+    memcpy(meta, Metadata, FTL_META_SIZE);
+    return FTL_Put(offset / FTL_PAGE_SIZE, 0, 0, NULL, 0xFF, meta) && FTL_Flush();
+}
+
+#endif // LPC43XX_SPIFI_FTL_SIZE > 0
@@ -0,0 +1,124 @@
+////////////////////////////////////////////////////////////////////////////////
+// LPC43XX_PCSample.cpp - PC sampling profiler for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+
+#include <tinyhal.h>
+#include "LPC43XX.h"
+
+#if LPC43XX_PC_SAMPLE_HZ > 0
+
+// SysTick samples the interrupted PC into buckets over the start of the flash
+// image. When LPC43XX_PC_SAMPLE_SECONDS have been sampled the counts are
+// printed for Toolchain\hotcode.py, which ranks the functions for the hot
+// code list in the scatter files.
+//
+// The stub, the handler and the dump callback it enqueues are in flash.
+// SPIFI command mode holds SysTick off like the other flash handlers, see
+// SPIFI_MaskFlashIrqs, so a tick never fetches from the SPIFI while it is
+// busy. A tick due during a flash operation is taken at its end.
+
+#define PCS_BUCKETS       (LPC43XX_PC_SAMPLE_SIZE >> LPC43XX_PC_SAMPLE_SHIFT)
+#define SYSTICK_VECTOR    15
+
+extern "C"
+{
+    void PCSAMPLE_SubHandler(void);
+    void PCSAMPLE_Handler(UINT32 pc);
+}
+
+static UINT16* pcs_count;
+static UINT32 pcs_total;    // Samples taken
+static UINT32 pcs_other;    // Samples outside the buckets, code in SRAM
+static UINT32 pcs_left;
+static HAL_CONTINUATION pcs_dump;
+
+static void PCSample_Dump(void* param);
+
+// ---------------------------------------------------------------------------
+// Starts sampling, the dynamic vector table must be in place
+void PCSample_Initialize()
+{
+    if (pcs_count == NULL) pcs_count = (UINT16 *)private_malloc(PCS_BUCKETS * sizeof(UINT16));
+    if (pcs_count == NULL) {
+        debug_printf("PCSAMPLE no memory\r\n");
+        return;
+    }
+    memset(pcs_count, 0, PCS_BUCKETS * sizeof(UINT16));
+    pcs_total = 0;
+    pcs_other = 0;
+    pcs_left = LPC43XX_PC_SAMPLE_HZ * LPC43XX_PC_SAMPLE_SECONDS;
+    pcs_dump.InitializeCallback(PCSample_Dump, NULL);
+
+    ((UINT32 *)SCB->VTOR)[SYSTICK_VECTOR] = (UINT32)PCSAMPLE_SubHandler;
+    SysTick->LOAD = SYSTEM_CLOCK_HZ / LPC43XX_PC_SAMPLE_HZ - 1;
+    SysTick->VAL = 0;
+    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+}
+
+// ---------------------------------------------------------------------------
+// SysTick entry, passes the PC stacked on exception entry. Code runs on the
+// main stack only.
+#ifndef __GNUC__
+__asm void PCSAMPLE_SubHandler(void)
+{
+    IMPORT  PCSAMPLE_Handler
+    LDR     r0,[sp,#24]
+    B       PCSAMPLE_Handler
+}
+#else
+void __attribute__((naked)) PCSAMPLE_SubHandler(void)
+{
+    asm("LDR r0,[sp,#24]");
+    asm("B PCSAMPLE_Handler");
+}
+#endif
+
+// ---------------------------------------------------------------------------
+void PCSAMPLE_Handler(UINT32 pc)
+{
+    UINT32 offset = pc - FLASH_MEMORY_Base;
+
+    if (offset < LPC43XX_PC_SAMPLE_SIZE) {
+        UINT16* count = &pcs_count[offset >> LPC43XX_PC_SAMPLE_SHIFT];
+        if (*count < 0xFFFF) (*count)++;
+    } else {
+        pcs_other++;
+    }
+    pcs_total++;
+
+    if (--pcs_left == 0) {
+        SysTick->CTRL = 0;
+        pcs_dump.Enqueue();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Header with the base, bucket shift and totals, then one line per bucket hit
+static void PCSample_Dump(void* param)
+{
+    UINT32 i;
+
+    debug_printf("PCSAMPLE %08x %d %d %d\r\n", FLASH_MEMORY_Base, LPC43XX_PC_SAMPLE_SHIFT, pcs_total, pcs_other);
+    for (i = 0; i < PCS_BUCKETS; i++) {
+        if (pcs_count[i])
+            debug_printf("PCS %08x %d\r\n", FLASH_MEMORY_Base + (i << LPC43XX_PC_SAMPLE_SHIFT), pcs_count[i]);
+    }
+    debug_printf("PCSAMPLE END\r\n");
+}
+
+#endif // LPC43XX_PC_SAMPLE_HZ > 0
@@ -28,6 +28,9 @@ static UINT64 g_lastCount;
 static UINT64 g_nextEvent;
 
 void systimer_handler(void* param);
+#if LPC43XX_PC_SAMPLE_HZ > 0
+void PCSample_Initialize();
+#endif
 
 // ---------------------------------------------------------------------------
 BOOL HAL_Time_Initialize()
@@ -44,6 +47,9 @@ BOOL HAL_Time_Initialize()
 
     CPU_INTC_ActivateInterrupt(SYSTIMER_IRQn, systimer_handler, 0);
 
+#if LPC43XX_PC_SAMPLE_HZ > 0
+    PCSample_Initialize();
+#endif
     return TRUE;
 }
 
@@ -20,6 +20,9 @@
 #include <tinyhal.h>
 #include "LPC43XX.h"
 #include "LPC43XX_PINS.h"
+#include "..\LPC43XX_GPDMA\LPC43XX_GPDMA.h"
+#include "LPC43XX_USART.h"
+#include "LPC43XX_USART_Baud.h"
 
 // Registers on LPC43XX USARTs to 550 industry standard (16C550)
 
@@ -43,14 +46,26 @@ typedef struct
   int ctsConf;
   UINT32 irq;
   HAL_CALLBACK_FPN isr;
+  UINT32 txReq;
+  UINT32 rxReq;
+  UINT32 rxTrig;
+  GPIO_PIN dirPin;
+  int dirConf;
 } USART_PORT_T;
 
 static USART_PORT_T const __section(rodata) USART_Port[TOTAL_USART_PORT] = {
-    {LPC_USART0, (GPIO_PIN)UART0_TX, 2, (GPIO_PIN)UART0_RX, 2, 0, 0, 0, 0, USART0_IRQn, USART0_IRQHandler},
+    {LPC_USART0, (GPIO_PIN)UART0_TX, 2, (GPIO_PIN)UART0_RX, 2, 0, 0, 0, 0, USART0_IRQn, USART0_IRQHandler,
+                 GPDMA_REQ_USART0_TX, GPDMA_REQ_USART0_RX, LPC43XX_USART0_RX_TRIGGER,
+                 (GPIO_PIN)LPC43XX_USART0_DIR_PIN, LPC43XX_USART0_DIR_CONF},
     {LPC_UART1,  (GPIO_PIN)UART1_TX, 4, (GPIO_PIN)UART1_RX, 1,
-                 (GPIO_PIN)UART1_RTS, 4, (GPIO_PIN)UART1_CTS, 4, UART1_IRQn,  USART1_IRQHandler},
-    {LPC_USART2, (GPIO_PIN)UART2_TX, 2, (GPIO_PIN)UART2_RX, 2, 0, 0, 0, 0, USART2_IRQn, USART2_IRQHandler},
-    {LPC_USART3, (GPIO_PIN)UART3_TX, 2, (GPIO_PIN)UART3_RX, 2, 0, 0, 0, 0, USART3_IRQn, USART3_IRQHandler}};
+                 (GPIO_PIN)UART1_RTS, 4, (GPIO_PIN)UART1_CTS, 4, UART1_IRQn,  USART1_IRQHandler,
+                 GPDMA_REQ_UART1_TX, GPDMA_REQ_UART1_RX, LPC43XX_USART1_RX_TRIGGER, 0, 0},
+    {LPC_USART2, (GPIO_PIN)UART2_TX, 2, (GPIO_PIN)UART2_RX, 2, 0, 0, 0, 0, USART2_IRQn, USART2_IRQHandler,
+                 GPDMA_REQ_USART2_TX, GPDMA_REQ_USART2_RX, LPC43XX_USART2_RX_TRIGGER,
+                 (GPIO_PIN)LPC43XX_USART2_DIR_PIN, LPC43XX_USART2_DIR_CONF},
+    {LPC_USART3, (GPIO_PIN)UART3_TX, 2, (GPIO_PIN)UART3_RX, 2, 0, 0, 0, 0, USART3_IRQn, USART3_IRQHandler,
+                 GPDMA_REQ_USART3_TX, GPDMA_REQ_USART3_RX, LPC43XX_USART3_RX_TRIGGER,
+                 (GPIO_PIN)LPC43XX_USART3_DIR_PIN, LPC43XX_USART3_DIR_CONF}};
 
 #define USART_REG(x)     (USART_Port[x].reg)
 #define USART_TxPin(x)   (USART_Port[x].txPin)
@@ -63,47 +78,191 @@ static USART_PORT_T const __section(rodata) USART_Port[TOTAL_USART_PORT] = {
 #define USART_CtsConf(x) (USART_Port[x].ctsConf)
 #define USART_IRQ(x)     (USART_Port[x].irq)
 #define USART_ISR(x)     (USART_Port[x].isr)
+#define USART_TxReq(x)   (USART_Port[x].txReq)
+#define USART_RxReq(x)   (USART_Port[x].rxReq)
+#define USART_RxTrig(x)  (USART_Port[x].rxTrig)
+#define USART_DirPin(x)  (USART_Port[x].dirPin)
+#define USART_DirConf(x) (USART_Port[x].dirConf)
 
 // USART IER (Interrupt Enable Register) Flags
 #define IER_RxIrq        (1 << 0)
 #define IER_TxIrq        (1 << 1)
+#define IER_RlsIrq       (1 << 2)
 // USART IIR (Interrupt Identification Register) Flags
 #define IIR_NoInt        (1 << 0)
 // USART LSR (Line Status Register) Flags
 #define LSR_RxBufData    (1 << 0)
+#define LSR_Overrun      (1 << 1)
+#define LSR_Parity       (1 << 2)
+#define LSR_Framing      (1 << 3)
+#define LSR_Break        (1 << 4)
+#define LSR_Errors       (LSR_Overrun | LSR_Parity | LSR_Framing | LSR_Break)
 #define LSR_TxBufEmpty   (1 << 5)
 #define LSR_TxRegEmpty   (1 << 6)
+// USART FCR (FIFO Control Register) Flags
+#define FCR_DmaMode      (1 << 3)
+// USART MCR (Modem Control Register) Flags
+#define MCR_RtsEn        (1 << 6)  // Auto RTS
+#define MCR_CtsEn        (1 << 7)  // Auto CTS
+// USART MSR (Modem Status Register) Flags
+#define MSR_Cts          (1 << 4)
+// USART LCR (Line Control Register) Fields
+#define LCR_WordLen8     (3 << 0)
+#define LCR_ParityEn     (1 << 3)
+#define LCR_ParityMask   (3 << 4)
+#define LCR_ParityMark   (2 << 4)  // Forced 1, address byte in multidrop
+#define LCR_ParitySpace  (3 << 4)  // Forced 0, data byte in multidrop
+// USART RS485CTRL Flags
+#define RS485_NMMEN      (1 << 0)  // Normal multidrop mode
+#define RS485_RXDIS      (1 << 1)  // Receiver disabled
+#define RS485_AADEN      (1 << 2)  // Auto address detect
+#define RS485_DCTRL      (1 << 4)  // Auto direction control
+#define RS485_OINV       (1 << 5)  // Direction pin polarity
+
+// DMA transmit. Ports in LPC43XX_USART_DMA_TX_PORTS move characters from the
+// PAL TX queue to a staging buffer and send each span with one GPDMA transfer,
+// so there is one interrupt and one COM_OUT event per span instead of per char.
+//
+// DMA receive. Ports in LPC43XX_USART_DMA_RX_PORTS run a GPDMA channel into a
+// circular buffer built from linked list items. The buffer is published to the
+// PAL on each segment terminal count and on the character timeout interrupt,
+// so an idle line flushes partial bursts.
+//
+// Span mode. CPU_USART_SpanEnable() stops publishing to the PAL and leaves
+// received data in the DMA buffer, where CPU_USART_RxSpan() hands it out in
+// place. CPU_USART_TxSpan() lends the staging buffer while no PAL transmit is
+// in progress. Readers must keep up. With auto RTS the channel halts before a
+// segment with unread data is overwritten, otherwise the oldest data is
+// dropped and counted as an overrun. The same applies while the PAL buffer is
+// full outside span mode.
+#define USART_DMA_RX_SEGMENTS  4
+#define USART_DMA_RX_SEGSIZE   (LPC43XX_USART_DMA_RX_SIZE / USART_DMA_RX_SEGMENTS)
+
+#if LPC43XX_USART_DMA_TX_SIZE > GPDMA_MAX_SIZE
+#error LPC43XX_USART_DMA_TX_SIZE must fit in one GPDMA transfer
+#endif
+
+typedef struct
+{
+  BOOL txDma;      // GPDMA channel allocated
+  UINT8 txCh;
+  BOOL txEnabled;  // PAL requested transmit
+  volatile BOOL txBusy; // Transfer or RS-485 address in progress
+  BOOL rxDma;
+  UINT8 rxCh;
+  UINT32 rxTail;   // Next unread index in RX buffer
+  BOOL rxEnabled;  // PAL accepting, IER_RxIrq follows it unless halted
+  BOOL rxSpan;     // Span mode, RX data stays in the DMA buffer
+  BOOL txSpan;     // Staging buffer lent by CPU_USART_TxSpan()
+} USART_DMA_T;
+
+static USART_DMA_T usart_dma[TOTAL_USART_PORT];
+
+#define USART_TxDma(x)   (usart_dma[x].txDma)
+#define USART_RxDma(x)   (usart_dma[x].rxDma)
+
+// DMA buffers exist only for the ports in the masks. A port's slot is the
+// number of enabled ports below it.
+#define USART_PORT_BITS(m)     ((((m) >> 0) & 1) + (((m) >> 1) & 1) + (((m) >> 2) & 1) + (((m) >> 3) & 1))
+#define USART_DMA_TX_SLOT(x)   USART_PORT_BITS(LPC43XX_USART_DMA_TX_PORTS & ((1 << (x)) - 1))
+#define USART_DMA_RX_SLOT(x)   USART_PORT_BITS(LPC43XX_USART_DMA_RX_PORTS & ((1 << (x)) - 1))
+
+#pragma arm section zidata = "SectionForDMA"
+#if LPC43XX_USART_DMA_TX_PORTS
+ALIGNED(4) static UINT8 usart_tx_buf[USART_PORT_BITS(LPC43XX_USART_DMA_TX_PORTS)][LPC43XX_USART_DMA_TX_SIZE];
+#define USART_TxBuf(x)   (usart_tx_buf[USART_DMA_TX_SLOT(x)])
+#else
+#define USART_TxBuf(x)   ((UINT8 *)NULL)
+#endif
+#if LPC43XX_USART_DMA_RX_PORTS
+ALIGNED(4) static UINT8 usart_rx_buf[USART_PORT_BITS(LPC43XX_USART_DMA_RX_PORTS)][LPC43XX_USART_DMA_RX_SIZE];
+ALIGNED(4) static GPDMA_LLI_T usart_rx_lli[USART_PORT_BITS(LPC43XX_USART_DMA_RX_PORTS)][USART_DMA_RX_SEGMENTS];
+#define USART_RxBuf(x)   (usart_rx_buf[USART_DMA_RX_SLOT(x)])
+#define USART_RxLli(x)   (usart_rx_lli[USART_DMA_RX_SLOT(x)])
+#else
+#define USART_RxBuf(x)   ((UINT8 *)NULL)
+#define USART_RxLli(x)   ((GPDMA_LLI_T *)NULL)
+#endif
+#pragma arm section zidata
+
+// Per-port statistics, ISR time measured with the DWT cycle counter
+static USART_STATISTICS usart_stats[TOTAL_USART_PORT];
+
+#define USART_MAX(a, b)  if ((b) > (a)) (a) = (b)
 
 // Local functions
+static void USART_CountErrors(int ComPortNum, UINT32 lsr);
+static BOOL USART_BaudDivisor(int BaudRate, UINT16& DL, UINT8& DivAddVal, UINT8& MulVal);
 static BOOL USART_Config(int ComPortNum, int BaudRate, int Parity,
                          int DataBits, int StopBits, int FlowValue);
+static int  USART_TxFill(int ComPortNum);
+static void USART_DmaTxStart(int ComPortNum);
+static void USART_DmaTxHandler(void* param, UINT32 status);
+static void USART_DmaRxStart(int ComPortNum);
+static void USART_DmaRxFlush(int ComPortNum);
+static void USART_DmaRxHandler(void* param, UINT32 status);
+static BOOL USART_DmaRxThrottle(int ComPortNum);
+static UINT32 USART_DmaRxHead(int ComPortNum);
 
 // ---------------------------------------------------------------------------
 void USART_IRQHandler(int ComPortNum)
 {
     LPC_USART_T *usart = USART_REG(ComPortNum);
+    USART_STATISTICS *stats = &usart_stats[ComPortNum];
+    UINT32 start = DWT->CYCCNT;
     char c;
 
+    stats->interrupts++;
     while (!(usart->IIR & IIR_NoInt)) // Interrupt pending?
     {
         int lsr = usart->LSR;
-        if (lsr & LSR_TxBufEmpty) // Transmitter available?
+        USART_CountErrors(ComPortNum, lsr);
+        if ((lsr & LSR_TxBufEmpty) && !USART_TxDma(ComPortNum)
+            && !usart_dma[ComPortNum].txBusy) // Transmitter available?
         {
-            if (USART_RemoveCharFromTxBuffer(ComPortNum, c))
+            int n = USART_TxFill(ComPortNum);
+            if (n)
             {
-                usart->THR = c;  // Write data
+                stats->bytesOut += n;
+                USART_MAX(stats->txFifoMax, (UINT32)n);
                 Events_Set(SYSTEM_EVENT_FLAG_COM_OUT);
             } else {
                 CPU_USART_TxBufferEmptyInterruptEnable(ComPortNum, FALSE); // Disable interrupt
             }
         }
-        if (lsr & LSR_RxBufData) // Data received?
+        if ((lsr & LSR_RxBufData) && !USART_RxDma(ComPortNum)
+            && (usart->IER & IER_RxIrq)) // Data received and PAL accepting?
         {
-            c = (char)(usart->RBR); // Read data
-            USART_AddCharToRxBuffer(ComPortNum, c);
+            UINT32 n = 0;
+            do { // Drain FIFO
+                c = (char)(usart->RBR); // Read data
+                USART_AddCharToRxBuffer(ComPortNum, c);
+                n++;
+                lsr = usart->LSR;
+                USART_CountErrors(ComPortNum, lsr);
+            } while (lsr & LSR_RxBufData);
+            stats->bytesIn += n;
+            USART_MAX(stats->rxFifoMax, n);
             Events_Set(SYSTEM_EVENT_FLAG_COM_IN);
         }
     }
+
+    // Trigger level or character timeout, publish what the DMA has received
+    if (USART_RxDma(ComPortNum)) USART_DmaRxFlush(ComPortNum);
+
+    USART_MAX(stats->isrCyclesMax, DWT->CYCCNT - start);
+}
+
+// ---------------------------------------------------------------------------
+static void USART_CountErrors(int ComPortNum, UINT32 lsr)
+{
+    USART_STATISTICS *stats = &usart_stats[ComPortNum];
+
+    if (!(lsr & LSR_Errors)) return;
+    if (lsr & LSR_Overrun) stats->overruns++;
+    if (lsr & LSR_Break) stats->breaks++;
+    else if (lsr & LSR_Framing) stats->framingErrors++; // Break also sets FE
+    if (lsr & LSR_Parity) stats->parityErrors++;
 }
 
 // ---------------------------------------------------------------------------
@@ -113,44 +272,231 @@ void USART1_IRQHandler(void* param) { USART_IRQHandler(1); }
 void USART2_IRQHandler(void* param) { USART_IRQHandler(2); }
 void USART3_IRQHandler(void* param) { USART_IRQHandler(3); }
 
+// ---------------------------------------------------------------------------
+// Writes pending characters to the empty TX FIFO, returns the count written
+static int USART_TxFill(int ComPortNum)
+{
+    LPC_USART_T *usart = USART_REG(ComPortNum);
+    int n = 0;
+    char c;
+
+    while (n < LPC43XX_USART_TX_FIFO_FILL && USART_RemoveCharFromTxBuffer(ComPortNum, c))
+    {
+        usart->THR = c;  // Write data
+        n++;
+    }
+    return n;
+}
+
+// ---------------------------------------------------------------------------
+// Fills the staging buffer from the PAL TX queue and starts the transfer.
+// Called with interrupts disabled or from the DMA ISR.
+static void USART_DmaTxStart(int ComPortNum)
+{
+    USART_DMA_T *dma = &usart_dma[ComPortNum];
+    UINT8 *buf = USART_TxBuf(ComPortNum);
+    int len = 0;
+    char c;
+
+    if (dma->txBusy || dma->txSpan) return;
+
+    while (len < LPC43XX_USART_DMA_TX_SIZE && USART_RemoveCharFromTxBuffer(ComPortNum, c))
+    {
+        buf[len++] = c;
+    }
+    if (len == 0)
+    {
+        dma->txEnabled = FALSE; // Nothing pending
+        return;
+    }
+
+    dma->txBusy = TRUE;
+    if (!GPDMA_Transfer(dma->txCh, (UINT32)buf, (UINT32)&USART_REG(ComPortNum)->THR,
+                        GPDMA_CTRL_SIZE(len) | GPDMA_CTRL_SBSIZE(GPDMA_BURST_1)
+                        | GPDMA_CTRL_DBSIZE(GPDMA_BURST_1) | GPDMA_CTRL_SWIDTH(GPDMA_WIDTH_BYTE)
+                        | GPDMA_CTRL_DWIDTH(GPDMA_WIDTH_BYTE) | GPDMA_CTRL_DST_AHB1
+                        | GPDMA_CTRL_SRC_INC | GPDMA_CTRL_TC_IRQ,
+                        USART_TxReq(ComPortNum), GPDMA_CFG_M2P, NULL))
+    {
+        dma->txBusy = FALSE; // Channel unavailable, the data is lost
+        return;
+    }
+    usart_stats[ComPortNum].bytesOut += len;
+    USART_MAX(usart_stats[ComPortNum].txFifoMax, (UINT32)len);
+}
+
+// ---------------------------------------------------------------------------
+static void USART_DmaTxHandler(void* param, UINT32 status)
+{
+    int ComPortNum = (int)param;
+    USART_DMA_T *dma = &usart_dma[ComPortNum];
+
+    usart_stats[ComPortNum].interrupts++;
+    dma->txBusy = FALSE;
+    Events_Set(SYSTEM_EVENT_FLAG_COM_OUT);
+    if (dma->txEnabled) USART_DmaTxStart(ComPortNum);
+}
+
+// ---------------------------------------------------------------------------
+// Starts the circular receive transfer. Each segment links to the next and
+// the last one back to the first, so the channel never stops.
+static void USART_DmaRxStart(int ComPortNum)
+{
+    GPDMA_LLI_T *lli = USART_RxLli(ComPortNum);
+    UINT8 *buf = USART_RxBuf(ComPortNum);
+    UINT32 src = (UINT32)&USART_REG(ComPortNum)->RBR;
+    UINT32 ctrl = GPDMA_CTRL_SIZE(USART_DMA_RX_SEGSIZE) | GPDMA_CTRL_SBSIZE(GPDMA_BURST_1)
+                  | GPDMA_CTRL_DBSIZE(GPDMA_BURST_1) | GPDMA_CTRL_SWIDTH(GPDMA_WIDTH_BYTE)
+                  | GPDMA_CTRL_DWIDTH(GPDMA_WIDTH_BYTE) | GPDMA_CTRL_SRC_AHB1
+                  | GPDMA_CTRL_DST_INC | GPDMA_CTRL_TC_IRQ;
+
+    for (int i = 0; i < USART_DMA_RX_SEGMENTS; i++)
+    {
+        lli[i].src = src;
+        lli[i].dst = (UINT32)&buf[i * USART_DMA_RX_SEGSIZE];
+        lli[i].lli = (UINT32)&lli[(i + 1) % USART_DMA_RX_SEGMENTS];
+        lli[i].ctrl = ctrl;
+    }
+
+    usart_dma[ComPortNum].rxTail = 0;
+    GPDMA_Transfer(usart_dma[ComPortNum].rxCh, lli[0].src, lli[0].dst, lli[0].ctrl,
+                   USART_RxReq(ComPortNum), GPDMA_CFG_P2M, &lli[1]);
+}
+
+// ---------------------------------------------------------------------------
+// Moves received data between the tail and the DMA write position to the PAL
+static void USART_DmaRxFlush(int ComPortNum)
+{
+    USART_DMA_T *dma = &usart_dma[ComPortNum];
+    UINT8 *buf = USART_RxBuf(ComPortNum);
+    UINT32 head, tail;
+
+    GLOBAL_LOCK(irq);
+
+    // Rx interrupt disabled by the PAL, keep data in the DMA buffer
+    if (!dma->rxEnabled) return;
+
+    // Span mode, data is consumed in place
+    if (dma->rxSpan)
+    {
+        Events_Set(SYSTEM_EVENT_FLAG_COM_IN);
+        return;
+    }
+
+    tail = dma->rxTail;
+    head = USART_DmaRxHead(ComPortNum);
+    if (head == tail) return;
+
+    // Stop when the PAL high-water mark disables the interrupt, the rest stays
+    // in the ring and the throttle halts the channel
+    UINT32 n = 0;
+    while (tail != head && dma->rxEnabled)
+    {
+        USART_AddCharToRxBuffer(ComPortNum, (char)buf[tail]);
+        if (++tail >= LPC43XX_USART_DMA_RX_SIZE) tail = 0;
+        n++;
+    }
+    usart_stats[ComPortNum].bytesIn += n;
+    USART_MAX(usart_stats[ComPortNum].rxFifoMax, n);
+    dma->rxTail = tail;
+    USART_DmaRxThrottle(ComPortNum);
+    Events_Set(SYSTEM_EVENT_FLAG_COM_IN);
+}
+
+// ---------------------------------------------------------------------------
+static void USART_DmaRxHandler(void* param, UINT32 status)
+{
+    int ComPortNum = (int)param;
+    USART_DMA_T *dma = &usart_dma[ComPortNum];
+
+    usart_stats[ComPortNum].interrupts++;
+
+    // The channel continues into the next segment. If the span reader, or the
+    // PAL with its buffer full, still holds data there, halt the channel when
+    // auto RTS can throttle the peer. Otherwise drop the unread data up to the
+    // following segment boundary and count an overrun.
+    if (!USART_DmaRxThrottle(ComPortNum))
+    {
+        UINT32 head = USART_DmaRxHead(ComPortNum);
+        UINT32 used = (head + LPC43XX_USART_DMA_RX_SIZE - dma->rxTail) % LPC43XX_USART_DMA_RX_SIZE;
+        if (used > LPC43XX_USART_DMA_RX_SIZE - USART_DMA_RX_SEGSIZE)
+        {
+            dma->rxTail = (head - head % USART_DMA_RX_SEGSIZE + USART_DMA_RX_SEGSIZE)
+                          % LPC43XX_USART_DMA_RX_SIZE;
+            usart_stats[ComPortNum].overruns++;
+        }
+    }
+    USART_DmaRxFlush(ComPortNum);
+}
+
+// ---------------------------------------------------------------------------
+// With auto RTS the channel is halted while the PAL buffer is full or the
+// ring has less than a segment free, so the FIFO fills and RTS throttles the
+// peer. RDA and CTI stay pending while nothing reads the FIFO, so the RX
+// interrupt is masked for as long as the channel is halted or the PAL is not
+// accepting. Returns FALSE if the port has no auto RTS. Call with interrupts
+// disabled.
+static BOOL USART_DmaRxThrottle(int ComPortNum)
+{
+    USART_DMA_T *dma = &usart_dma[ComPortNum];
+    LPC_USART_T *usart = USART_REG(ComPortNum);
+    BOOL rts = (ComPortNum == 1 && (usart->MCR & MCR_RtsEn));
+    BOOL halt = FALSE;
+
+    if (rts)
+    {
+        UINT32 head = USART_DmaRxHead(ComPortNum);
+        UINT32 used = (head + LPC43XX_USART_DMA_RX_SIZE - dma->rxTail) % LPC43XX_USART_DMA_RX_SIZE;
+        halt = (used > LPC43XX_USART_DMA_RX_SIZE - USART_DMA_RX_SEGSIZE)
+               || (!dma->rxSpan && !dma->rxEnabled);
+        GPDMA_Halt(dma->rxCh, halt);
+    }
+
+    if (dma->rxEnabled && !halt) usart->IER |= IER_RxIrq;
+    else usart->IER &= ~IER_RxIrq;
+    return rts;
+}
+
+// ---------------------------------------------------------------------------
+// Index in the RX buffer where the DMA writes the next character
+static UINT32 USART_DmaRxHead(int ComPortNum)
+{
+    UINT32 head = GPDMA_DestAddress(usart_dma[ComPortNum].rxCh) - (UINT32)USART_RxBuf(ComPortNum);
+    return (head >= LPC43XX_USART_DMA_RX_SIZE) ? 0 : head;
+}
+
+// ---------------------------------------------------------------------------
+// Standard rates from the table, others from the integer solver
+static BOOL USART_BaudDivisor(int BaudRate, UINT16& DL, UINT8& DivAddVal, UINT8& MulVal)
+{
+    if (BaudRate <= 0) return FALSE;
+
+#if (SYSTEM_CLOCK_HZ == 204000000)
+    for (int i = 0; i < ARRAYSIZE(USART_BaudTable); i++)
+    {
+        if (USART_BaudTable[i].baud == (UINT32)BaudRate)
+        {
+            DL = USART_BaudTable[i].dl;
+            DivAddVal = USART_BaudTable[i].divAddVal;
+            MulVal = USART_BaudTable[i].mulVal;
+            return TRUE;
+        }
+    }
+#endif
+
+    return USART_BaudSolve(SystemCoreClock, BaudRate, DL, DivAddVal, MulVal);
+}
+
 // ---------------------------------------------------------------------------
 static BOOL USART_Config(int ComPortNum, int BaudRate, int Parity,
                   int DataBits, int StopBits, int FlowValue)
 {
     LPC_USART_T *usart = USART_REG(ComPortNum);
-    uint32_t PCLK = SystemCoreClock;
+    UINT16 DL;
+    UINT8 DivAddVal, MulVal;
 
-    // First we check to see if the basic divide with no DivAddVal/MulVal
-    // ratio gives us an integer result. If it doesG// and/or lookup tables, but the brute force method is not that much
-    // slower, and is more maintainable.
-    uint16_t DL = PCLK / (16 * BaudRate);
-
-    uint8_t DivAddVal = 0;
-    uint8_t MulVal = 1;
-    int hit = 0;
-    uint16_t dlv;
-    uint8_t mv, dav;
-    if ((PCLK % (16 * BaudRate)) != 0) {     // Checking for zero remainder
-        float err_best = (float) BaudRate;
-        uint16_t dlmax = DL;
-        for ( dlv = (dlmax/2); (dlv <= dlmax) && !hit; dlv++) {
-            for ( mv = 1; mv <= 15; mv++) {
-                for ( dav = 1; dav < mv; dav++) {
-                    float ratio = 1.0f + ((float) dav / (float) mv);
-                    float calcbaud = (float)PCLK / (16.0f * (float) dlv * ratio);
-                    float err = fabs(((float) BaudRate - calcbaud) / (float) BaudRate);
-                    if (err < err_best) {
-                        DL = dlv;
-                        DivAddVal = dav;
-                        MulVal = mv;
-                        err_best = err;
-                        if (err < 0.001f) {
-                            hit = 1;
-                        }
-                    }
-                }
-            }
-        }
+    if (!USART_BaudDivisor(BaudRate, DL, DivAddVal, MulVal)) {
+        return FALSE; // Baud rate out of range
     }
     
     // set LCR[DLAB] to enable writing to divider registers
@@ -202,36 +548,89 @@ BOOL CPU_USART_Initialize(int ComPortNum, int BaudRate, int Parity,
     volatile int tmp;
 
     if (ComPortNum >= TOTAL_USART_PORT) return FALSE;
+    if ((FlowValue & USART_FLOW_HW_IN_EN) && !USART_RtsPin(ComPortNum)) return FALSE;
+    if ((FlowValue & USART_FLOW_HW_OUT_EN) && !USART_CtsPin(ComPortNum)) return FALSE;
 
     GLOBAL_LOCK(irq);
 
+    // Cycle counter for ISR statistics
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
     // Configure USART pins
     PIN_Config(USART_TxPin(ComPortNum), (SCU_MODE_MODE_REPEATER | USART_TxConf(ComPortNum)));
     PIN_Config(USART_RxPin(ComPortNum), (SCU_PINIO_PULLNONE | USART_RxConf(ComPortNum)));
+    if (FlowValue & USART_FLOW_HW_IN_EN)
+        PIN_Config(USART_RtsPin(ComPortNum), (SCU_MODE_MODE_REPEATER | USART_RtsConf(ComPortNum)));
+    if (FlowValue & USART_FLOW_HW_OUT_EN)
+        PIN_Config(USART_CtsPin(ComPortNum), (SCU_PINIO_PULLNONE | USART_CtsConf(ComPortNum)));
 
     // Configure baud rate and format, enable clock
     usart->LCR = 0;
   	usart->ACR = 0;
-    USART_Config(ComPortNum, BaudRate, Parity, DataBits, StopBits, FlowValue);
+    if (!USART_Config(ComPortNum, BaudRate, Parity, DataBits, StopBits, FlowValue)) return FALSE;
     LPC_CGU->BASE_CLK[(CLK_BASE_UART0 + ComPortNum)] &= ~1;
 
-    // Enable transmitter, set modem flow control if COM2
+    // Enable transmitter, set modem flow control if COM2. Auto RTS deasserts
+    // RTS when the RX FIFO reaches the trigger level, which happens once the
+    // PAL disables the RX interrupt at its high water mark.
     usart->TER1 = (1 << 7);
     if (ComPortNum == 1) {
-        	usart->MCR = 0; // (1 << 6) | (1 << 7); // Auto RTS/CTS
+            usart->MCR = ((FlowValue & USART_FLOW_HW_IN_EN)  ? MCR_RtsEn : 0)
+                       | ((FlowValue & USART_FLOW_HW_OUT_EN) ? MCR_CtsEn : 0);
             tmp = usart->MSR; // Clear status
     } else {
             usart->TER2 = (1 << 0);
+            usart->RS485CTRL = 0; // RS-485 off until configured
+    }
+
+    // Use GPDMA for transmit if configured and a channel is available
+    if ((LPC43XX_USART_DMA_TX_PORTS & (1 << ComPortNum)) && !USART_TxDma(ComPortNum))
+    {
+        int ch = GPDMA_ChannelAlloc(USART_DmaTxHandler, (void*)ComPortNum);
+        if (ch >= 0)
+        {
+            usart_dma[ComPortNum].txCh = ch;
+            usart_dma[ComPortNum].txDma = TRUE;
+        }
+    }
+    if (USART_TxDma(ComPortNum)) GPDMA_Stop(usart_dma[ComPortNum].txCh);
+    usart_dma[ComPortNum].txEnabled = FALSE;
+    usart_dma[ComPortNum].txBusy = FALSE;
+    usart_dma[ComPortNum].txSpan = FALSE;
+
+    // Use GPDMA for receive if configured and a channel is available
+    if ((LPC43XX_USART_DMA_RX_PORTS & (1 << ComPortNum)) && !USART_RxDma(ComPortNum))
+    {
+        int ch = GPDMA_ChannelAlloc(USART_DmaRxHandler, (void*)ComPortNum);
+        if (ch >= 0)
+        {
+            usart_dma[ComPortNum].rxCh = ch;
+            usart_dma[ComPortNum].rxDma = TRUE;
+        }
     }
+    if (USART_RxDma(ComPortNum)) GPDMA_Stop(usart_dma[ComPortNum].rxCh);
+    usart_dma[ComPortNum].rxSpan = FALSE;
+    usart_dma[ComPortNum].rxEnabled = FALSE;
 
-    // Enable and reset FIFOs, level 2 = 8 char
-    usart->FCR = (1 << 0) | (1 << 1) | (1 << 2) | (2 << 6);
+    // Enable and reset FIFOs, RX trigger level per port
+    usart->FCR = (1 << 0) | (1 << 1) | (1 << 2) | ((USART_RxTrig(ComPortNum) & 3) << 6)
+                 | ((USART_TxDma(ComPortNum) || USART_RxDma(ComPortNum)) ? FCR_DmaMode : 0);
+    if (USART_RxDma(ComPortNum)) USART_DmaRxStart(ComPortNum);
 
     // Unprotect pins and activate interrupts
     usart->IER = 0; // Clear interrupts
+    // The DMA reads RBR, so line errors are only seen through the RLS interrupt
+    if (USART_RxDma(ComPortNum)) usart->IER = IER_RlsIrq;
     CPU_USART_ProtectPins(ComPortNum, FALSE);
     CPU_INTC_ActivateInterrupt(USART_IRQ(ComPortNum), USART_ISR(ComPortNum), 0);
 
+    // Default RS-485 driver enable for ports wired to a transceiver
+    if (LPC43XX_USART_RS485_PORTS & (1 << ComPortNum))
+    {
+        return CPU_USART_RS485_Configure(ComPortNum, USART_RS485_DIR_CTRL, 0,
+                                         LPC43XX_USART_RS485_DELAY);
+    }
     return TRUE;
 }
 
@@ -242,8 +641,28 @@ BOOL CPU_USART_Uninitialize(int ComPortNum)
 
     GLOBAL_LOCK(irq);
 
-    // Disable FIFOs, clock and interrupts
+    // Release DMA channel
+    if (USART_TxDma(ComPortNum))
+    {
+        GPDMA_ChannelFree(usart_dma[ComPortNum].txCh);
+        usart_dma[ComPortNum].txDma = FALSE;
+        usart_dma[ComPortNum].txEnabled = FALSE;
+        usart_dma[ComPortNum].txBusy = FALSE;
+        usart_dma[ComPortNum].txSpan = FALSE;
+    }
+    if (USART_RxDma(ComPortNum))
+    {
+        GPDMA_ChannelFree(usart_dma[ComPortNum].rxCh);
+        usart_dma[ComPortNum].rxDma = FALSE;
+        usart_dma[ComPortNum].rxSpan = FALSE;
+        usart_dma[ComPortNum].rxEnabled = FALSE;
+    }
+
+    // Disable flow control, RS-485, FIFOs, clock and interrupts
+    if (ComPortNum == 1) usart->MCR = 0;
+    else usart->RS485CTRL = 0;
     usart->FCR = 0;  // Disable FIFOs
+    usart->IER &= ~IER_RlsIrq;
     LPC_CGU->BASE_CLK[(CLK_BASE_UART0 + ComPortNum)] |= 1;
     CPU_INTC_DeactivateInterrupt(USART_IRQ(ComPortNum));
     CPU_USART_ProtectPins(ComPortNum, TRUE);  
@@ -253,12 +672,14 @@ BOOL CPU_USART_Uninitialize(int ComPortNum)
 // ---------------------------------------------------------------------------
 BOOL CPU_USART_TxBufferEmpty(int ComPortNum)
 {
+    if (usart_dma[ComPortNum].txBusy) return FALSE;
     return ((USART_REG(ComPortNum)->LSR & LSR_TxBufEmpty) ? TRUE : FALSE);
 }
 
 // ---------------------------------------------------------------------------
 BOOL CPU_USART_TxShiftRegisterEmpty(int ComPortNum)
 {
+    if (usart_dma[ComPortNum].txBusy) return FALSE;
     return ((USART_REG(ComPortNum)->LSR & LSR_TxRegEmpty) ? TRUE : FALSE);
 }
 
@@ -273,17 +694,29 @@ void CPU_USART_TxBufferEmptyInterruptEnable(int ComPortNum, BOOL Enable)
 {
     LPC_USART_T *usart = USART_REG(ComPortNum);
 
+    if (USART_TxDma(ComPortNum))
+    {
+        GLOBAL_LOCK(irq);
+        usart_dma[ComPortNum].txEnabled = Enable;
+        if (Enable) USART_DmaTxStart(ComPortNum);
+        return;
+    }
+
     if (Enable)
     {
         usart->IER |=  (IER_TxIrq);
 
         // Tx Empty irq in USART will trigger after data is transmitted.
         // If transmitter available and data is pending, get it started
-        char c;
-        if (usart->LSR & LSR_TxBufEmpty && USART_RemoveCharFromTxBuffer(ComPortNum, c))
+        if ((usart->LSR & LSR_TxBufEmpty) && !usart_dma[ComPortNum].txBusy)
         {
-            usart->THR = c;  // Write data
-            Events_Set(SYSTEM_EVENT_FLAG_COM_OUT);
+            GLOBAL_LOCK(irq);
+            int n = USART_TxFill(ComPortNum);
+            if (n)
+            {
+                usart_stats[ComPortNum].bytesOut += n;
+                Events_Set(SYSTEM_EVENT_FLAG_COM_OUT);
+            }
         }
     }
     else
@@ -295,6 +728,7 @@ void CPU_USART_TxBufferEmptyInterruptEnable(int ComPortNum, BOOL Enable)
 // ---------------------------------------------------------------------------
 BOOL CPU_USART_TxBufferEmptyInterruptState(int ComPortNum)
 {
+    if (USART_TxDma(ComPortNum)) return usart_dma[ComPortNum].txEnabled;
     if (USART_REG(ComPortNum)->IER & IER_TxIrq) return TRUE;
     return FALSE;
 }
@@ -304,6 +738,21 @@ void CPU_USART_RxBufferFullInterruptEnable(int ComPortNum, BOOL Enable)
 {
     LPC_USART_T *usart = USART_REG(ComPortNum);
 
+    // DMA receive ports mask the interrupt in USART_DmaRxThrottle
+    if (USART_RxDma(ComPortNum))
+    {
+        GLOBAL_LOCK(irq);
+        usart_dma[ComPortNum].rxEnabled = Enable;
+        USART_DmaRxThrottle(ComPortNum);
+        // Publish data the DMA received while the PAL buffer was full
+        if (Enable)
+        {
+            USART_DmaRxFlush(ComPortNum);
+            USART_DmaRxThrottle(ComPortNum);
+        }
+        return;
+    }
+
     if (Enable)
     {
        usart->IER |=  IER_RxIrq;
@@ -317,6 +766,7 @@ void CPU_USART_RxBufferFullInterruptEnable(int ComPortNum, BOOL Enable)
 // ---------------------------------------------------------------------------
 BOOL CPU_USART_RxBufferFullInterruptState(int ComPortNum)
 {
+    if (USART_RxDma(ComPortNum)) return usart_dma[ComPortNum].rxEnabled;
     if (USART_REG(ComPortNum)->IER & IER_RxIrq) return TRUE;
     return FALSE;
 }
@@ -362,8 +812,9 @@ void CPU_USART_GetBaudrateBoundary(int ComPortNum, UINT32& maxBaudRateHz, UINT32
 {
     uint32_t PCLK = SystemCoreClock;
 
+    // Min is limited by 16-bit DL with the largest fractional ratio 29/15
     maxBaudRateHz = PCLK >> 4;
-    minBaudRateHz = 75;
+    minBaudRateHz = (UINT32)(((UINT64)PCLK * 15) / ((UINT64)16 * USART_DL_MAX * 29)) + 1;
 }
 
 // ---------------------------------------------------------------------------
@@ -381,5 +832,210 @@ BOOL CPU_USART_IsBaudrateSupported(int ComPortNum, UINT32& BaudrateHz)
 // ---------------------------------------------------------------------------
 BOOL CPU_USART_TxHandshakeEnabledState(int comPort)
 {
+    // CTS asserted by the peer, or no hardware handshake
+    if (comPort == 1 && (USART_REG(comPort)->MCR & MCR_CtsEn))
+    {
+        return (USART_REG(comPort)->MSR & MSR_Cts) ? TRUE : FALSE;
+    }
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+BOOL CPU_USART_RS485_Configure(int ComPortNum, UINT32 Flags, UINT8 Address, UINT8 DelayBits)
+{
+    if (ComPortNum < 0 || ComPortNum >= TOTAL_USART_PORT || ComPortNum == 1) return FALSE; // USART only
+    if (Flags & ~(USART_RS485_DIR_CTRL | USART_RS485_DIR_INVERT | USART_RS485_ADDR_MATCH)) return FALSE;
+
+    LPC_USART_T *usart = USART_REG(ComPortNum);
+    UINT32 ctrl = 0;
+
+    // Check everything before the registers change
+    if ((Flags & USART_RS485_DIR_CTRL) && !USART_DirPin(ComPortNum)) return FALSE; // No DIR pin
+    if ((Flags & USART_RS485_ADDR_MATCH) && (usart->LCR & LCR_WordLen8) != LCR_WordLen8) return FALSE;
+
+    GLOBAL_LOCK(irq);
+
+    // Driver enable asserted by the UART while transmitting
+    if (Flags & USART_RS485_DIR_CTRL)
+    {
+        PIN_Config(USART_DirPin(ComPortNum), (SCU_MODE_MODE_REPEATER | USART_DirConf(ComPortNum)));
+        usart->RS485DLY = DelayBits;
+        ctrl |= RS485_DCTRL;
+        if (Flags & USART_RS485_DIR_INVERT) ctrl |= RS485_OINV;
+    }
+
+    // 9-bit addressing uses the parity bit. Data is sent with forced 0 parity,
+    // the receiver stays disabled until a matching address byte arrives.
+    if (Flags & USART_RS485_ADDR_MATCH)
+    {
+        usart->RS485ADRMATCH = Address;
+        usart->LCR = (usart->LCR & ~LCR_ParityMask) | LCR_ParityEn | LCR_ParitySpace;
+        ctrl |= RS485_NMMEN | RS485_AADEN | RS485_RXDIS;
+    }
+
+    usart->RS485CTRL = ctrl;
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+BOOL CPU_USART_RS485_SendAddress(int ComPortNum, UINT8 Address)
+{
+    if (ComPortNum < 0 || ComPortNum >= TOTAL_USART_PORT || ComPortNum == 1) return FALSE;
+
+    LPC_USART_T *usart = USART_REG(ComPortNum);
+    USART_DMA_T *dma = &usart_dma[ComPortNum];
+    UINT32 lcr;
+
+    if (!(usart->RS485CTRL & RS485_NMMEN)) return FALSE; // Not in multidrop mode
+
+    // Let pending data go out first, parity applies to the whole FIFO. Then
+    // hold the transmitter with txBusy, which PAL and DMA transmit wait on.
+    while (TRUE)
+    {
+        while (dma->txBusy || !(usart->LSR & LSR_TxRegEmpty));
+
+        GLOBAL_LOCK(irq);
+        if (dma->txBusy || !(usart->LSR & LSR_TxRegEmpty)) continue;
+
+        dma->txBusy = TRUE;
+        lcr = usart->LCR & ~LCR_ParityMask;
+        usart->LCR = lcr | LCR_ParityMark;
+        usart->THR = Address;
+        break;
+    }
+
+    // One character time with interrupts enabled
+    while (!(usart->LSR & LSR_TxRegEmpty));
+
+    GLOBAL_LOCK(irq);
+    usart->LCR = lcr | LCR_ParitySpace;
+    dma->txBusy = FALSE;
+
+    // Restart PAL transmit held off meanwhile
+    if (CPU_USART_TxBufferEmptyInterruptState(ComPortNum))
+        CPU_USART_TxBufferEmptyInterruptEnable(ComPortNum, TRUE);
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+BOOL CPU_USART_GetStatistics(int ComPortNum, USART_STATISTICS* Stats)
+{
+    if (ComPortNum < 0 || ComPortNum >= TOTAL_USART_PORT || Stats == NULL) return FALSE;
+
+    GLOBAL_LOCK(irq);
+    *Stats = usart_stats[ComPortNum];
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+BOOL CPU_USART_ResetStatistics(int ComPortNum)
+{
+    if (ComPortNum < 0 || ComPortNum >= TOTAL_USART_PORT) return FALSE;
+
+    GLOBAL_LOCK(irq);
+    memset(&usart_stats[ComPortNum], 0, sizeof(USART_STATISTICS));
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Span mode on a DMA receive port. Data already in the DMA buffer is kept
+// for the span reader when enabled and published to the PAL when disabled.
+BOOL CPU_USART_SpanEnable(int ComPortNum, BOOL Enable)
+{
+    if (ComPortNum < 0 || ComPortNum >= TOTAL_USART_PORT) return FALSE;
+    if (!USART_RxDma(ComPortNum)) return FALSE;
+
+    GLOBAL_LOCK(irq);
+    usart_dma[ComPortNum].rxSpan = Enable;
+    if (!Enable) USART_DmaRxFlush(ComPortNum);
+    USART_DmaRxThrottle(ComPortNum);
+    return TRUE;
+}
+
+// ---------------------------------------------------------------------------
+// Returns contiguous received data starting Offset characters past the read
+// position, or NULL if there is none. Length is set to the span size.
+UINT8* CPU_USART_RxSpan(int ComPortNum, UINT32 Offset, UINT32& Length)
+{
+    Length = 0;
+    if (ComPortNum < 0 || ComPortNum >= TOTAL_USART_PORT) return NULL;
+
+    USART_DMA_T *dma = &usart_dma[ComPortNum];
+    if (!dma->rxSpan) return NULL;
+
+    GLOBAL_LOCK(irq);
+    UINT32 head = USART_DmaRxHead(ComPortNum);
+    UINT32 used = (head + LPC43XX_USART_DMA_RX_SIZE - dma->rxTail) % LPC43XX_USART_DMA_RX_SIZE;
+    if (Offset >= used) return NULL;
+
+    UINT32 start = (dma->rxTail + Offset) % LPC43XX_USART_DMA_RX_SIZE;
+    Length = (head > start) ? head - start : LPC43XX_USART_DMA_RX_SIZE - start;
+    return USART_RxBuf(ComPortNum) + start;
+}
+
+// ---------------------------------------------------------------------------
+// Releases Length characters from the read position
+void CPU_USART_RxConsume(int ComPortNum, UINT32 Length)
+{
+    if (ComPortNum < 0 || ComPortNum >= TOTAL_USART_PORT) return;
+
+    USART_DMA_T *dma = &usart_dma[ComPortNum];
+    if (!dma->rxSpan) return;
+
+    GLOBAL_LOCK(irq);
+    UINT32 head = USART_DmaRxHead(ComPortNum);
+    UINT32 used = (head + LPC43XX_USART_DMA_RX_SIZE - dma->rxTail) % LPC43XX_USART_DMA_RX_SIZE;
+    if (Length > used) Length = used;
+    dma->rxTail = (dma->rxTail + Length) % LPC43XX_USART_DMA_RX_SIZE;
+    USART_DmaRxThrottle(ComPortNum);
+}
+
+// ---------------------------------------------------------------------------
+// Lends the DMA staging buffer for writing. Returns NULL while a transfer or
+// PAL transmit is in progress. The buffer stays reserved until TxCommit.
+UINT8* CPU_USART_TxSpan(int ComPortNum, UINT32& Length)
+{
+    Length = 0;
+    if (ComPortNum < 0 || ComPortNum >= TOTAL_USART_PORT) return NULL;
+    if (!USART_TxDma(ComPortNum)) return NULL;
+
+    USART_DMA_T *dma = &usart_dma[ComPortNum];
+
+    GLOBAL_LOCK(irq);
+    if (dma->txBusy || dma->txEnabled) return NULL;
+
+    dma->txSpan = TRUE;
+    Length = LPC43XX_USART_DMA_TX_SIZE;
+    return USART_TxBuf(ComPortNum);
+}
+
+// ---------------------------------------------------------------------------
+// Sends the first Length characters of the lent buffer and releases it
+BOOL CPU_USART_TxCommit(int ComPortNum, UINT32 Length)
+{
+    if (ComPortNum < 0 || ComPortNum >= TOTAL_USART_PORT) return FALSE;
+
+    USART_DMA_T *dma = &usart_dma[ComPortNum];
+
+    GLOBAL_LOCK(irq);
+    if (!dma->txSpan || Length > LPC43XX_USART_DMA_TX_SIZE) return FALSE;
+
+    dma->txSpan = FALSE;
+    if (Length == 0) return TRUE;
+
+    dma->txBusy = TRUE;
+    if (!GPDMA_Transfer(dma->txCh, (UINT32)USART_TxBuf(ComPortNum),
+                        (UINT32)&USART_REG(ComPortNum)->THR,
+                        GPDMA_CTRL_SIZE(Length) | GPDMA_CTRL_SBSIZE(GPDMA_BURST_1)
+                        | GPDMA_CTRL_DBSIZE(GPDMA_BURST_1) | GPDMA_CTRL_SWIDTH(GPDMA_WIDTH_BYTE)
+                        | GPDMA_CTRL_DWIDTH(GPDMA_WIDTH_BYTE) | GPDMA_CTRL_DST_AHB1
+                        | GPDMA_CTRL_SRC_INC | GPDMA_CTRL_TC_IRQ,
+                        USART_TxReq(ComPortNum), GPDMA_CFG_M2P, NULL))
+    {
+        dma->txBusy = FALSE; // Transfer did not start
+        return FALSE;
+    }
+    usart_stats[ComPortNum].bytesOut += Length;
+    USART_MAX(usart_stats[ComPortNum].txFifoMax, Length);
     return TRUE;
 }
@@ -0,0 +1,69 @@
+////////////////////////////////////////////////////////////////////////////////
+// LPC43XX_USART.h - USART declarations for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _LPC43XX_USART_H_
+#define _LPC43XX_USART_H_
+
+// LPC43XX extensions to the USART HAL
+
+// RS-485 mode flags (USART0/2/3 only)
+#define USART_RS485_DIR_CTRL    (1 << 0)  // Hardware driver enable on DIR pin
+#define USART_RS485_DIR_INVERT  (1 << 1)  // DIR pin active low
+#define USART_RS485_ADDR_MATCH  (1 << 2)  // 9-bit multidrop, receive only when addressed
+
+// RS-485 mode. DelayBits is the driver disable delay after the last stop bit
+// in bit times. With USART_RS485_ADDR_MATCH the port must use 8 data bits and
+// the receiver ignores all frames until an address byte matching Address.
+BOOL CPU_USART_RS485_Configure(int ComPortNum, UINT32 Flags, UINT8 Address, UINT8 DelayBits);
+// Sends an address byte (9th bit set) in multidrop mode. Data written after
+// it goes out with the 9th bit clear.
+BOOL CPU_USART_RS485_SendAddress(int ComPortNum, UINT8 Address);
+
+// Port statistics. FIFO maximums are the most characters moved in a single
+// interrupt or DMA span. ISR time is in CPU cycles.
+typedef struct
+{
+  UINT32 bytesIn;
+  UINT32 bytesOut;
+  UINT32 interrupts;
+  UINT32 rxFifoMax;
+  UINT32 txFifoMax;
+  UINT32 overruns;
+  UINT32 framingErrors;
+  UINT32 parityErrors;
+  UINT32 breaks;
+  UINT32 isrCyclesMax;
+} USART_STATISTICS;
+
+#define USART_STATISTICS_COUNT  (sizeof(USART_STATISTICS) / sizeof(UINT32))
+
+BOOL CPU_USART_GetStatistics(int ComPortNum, USART_STATISTICS* Stats);
+BOOL CPU_USART_ResetStatistics(int ComPortNum);
+
+// Zero-copy access to the GPDMA buffers on ports in LPC43XX_USART_DMA_RX_PORTS
+// and LPC43XX_USART_DMA_TX_PORTS. In span mode received data bypasses the PAL
+// RX queue and is read in place, then released with RxConsume. A TX span is
+// the staging buffer, filled by the caller and sent with TxCommit.
+BOOL   CPU_USART_SpanEnable(int ComPortNum, BOOL Enable);
+UINT8* CPU_USART_RxSpan(int ComPortNum, UINT32 Offset, UINT32& Length);
+void   CPU_USART_RxConsume(int ComPortNum, UINT32 Length);
+UINT8* CPU_USART_TxSpan(int ComPortNum, UINT32& Length);
+BOOL   CPU_USART_TxCommit(int ComPortNum, UINT32 Length);
+
+#endif // _LPC43XX_USART_H_
@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////////////////////////
+// LPC43XX_USART_Baud.h - USART baud rate divisors for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _LPC43XX_USART_BAUD_H_
+#define _LPC43XX_USART_BAUD_H_
+
+// Divisor solver shared by the driver and the host test in Test\, so it only
+// uses the base types and __section. PCLK is a parameter for the same reason.
+
+// Baud rate divisors. Baud = PCLK / (16 * DL * (1 + DivAddVal / MulVal))
+#define USART_DL_MAX     0xFFFF
+#define USART_DL_MIN_FD  3       // Minimum DL when DivAddVal > 0
+
+typedef struct
+{
+  UINT32 baud;
+  UINT16 dl;
+  UINT8 divAddVal;
+  UINT8 mulVal;
+} USART_BAUD_T;
+
+#if (SYSTEM_CLOCK_HZ == 204000000)
+// Standard rates at 204 MHz, same results as USART_BaudSolve()
+static USART_BAUD_T const __section(rodata) USART_BaudTable[] = {
+    {   1200, 10625, 0,  1}, {   2400, 5312, 0,  1}, {   4800, 2656, 0,  1},
+    {   9600,  1033, 2,  7}, {  14400,  613, 4,  9}, {  19200,  487, 4, 11},
+    {  38400,   332, 0,  1}, {  57600,  166, 1,  3}, { 115200,   83, 1,  3},
+    { 230400,    31, 11, 14}, { 460800,  24, 2, 13}, { 921600,   12, 2, 13},
+    {1000000,     9, 5, 12}, {2000000,    5, 3, 11}, {3000000,    3, 5, 12}};
+#endif
+
+// ---------------------------------------------------------------------------
+// Finds the divisor with the lowest error using integer math only. For each
+// MulVal/DivAddVal pair only the two DL values around the ideal one can be
+// best, so the search is at most 212 iterations and stops on an exact match.
+inline BOOL USART_BaudSolve(UINT32 PCLK, UINT32 BaudRate, UINT16& DL, UINT8& DivAddVal, UINT8& MulVal)
+{
+    UINT32 err_best = 0xFFFFFFFF;
+
+    if (BaudRate == 0) return FALSE;
+
+    for (UINT32 mv = 1; mv <= 15; mv++)
+    {
+        for (UINT32 dav = 0; dav < mv; dav++)
+        {
+            if (dav == 0 && mv != 1) continue; // Same as mv = 1
+
+            UINT64 dl_lo = ((UINT64)PCLK * mv) / ((UINT64)16 * BaudRate * (mv + dav));
+            for (UINT64 dl = dl_lo; dl <= dl_lo + 1; dl++)
+            {
+                if (dl == 0 || dl > USART_DL_MAX) continue;
+                if (dav && dl < USART_DL_MIN_FD) continue;
+
+                UINT64 div = 16 * dl * (mv + dav);
+                UINT32 baud = (UINT32)(((UINT64)PCLK * mv + div / 2) / div);
+                UINT32 err = (baud > BaudRate) ? baud - BaudRate : BaudRate - baud;
+                if (err < err_best)
+                {
+                    DL = (UINT16)dl;
+                    DivAddVal = (UINT8)dav;
+                    MulVal = (UINT8)mv;
+                    err_best = err;
+                    if (err == 0) return TRUE;
+                }
+            }
+        }
+    }
+    return (err_best != 0xFFFFFFFF);
+}
+
+#endif // _LPC43XX_USART_BAUD_H_
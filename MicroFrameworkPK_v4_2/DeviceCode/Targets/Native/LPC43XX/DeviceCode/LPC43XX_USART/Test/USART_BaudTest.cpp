@@ -0,0 +1,258 @@
+////////////////////////////////////////////////////////////////////////////////
+// USART_BaudTest.cpp - Host test and benchmark for the LPC43XX baud solver
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+//
+// Not part of the firmware build. On the host:
+//
+//   g++ -O2 -o USART_BaudTest USART_BaudTest.cpp && ./USART_BaudTest
+//   cl /O2 /EHsc USART_BaudTest.cpp && USART_BaudTest
+//
+// Sweeps 75 baud to PCLK/16 and checks that USART_BaudSolve() gives a valid
+// setting for every rate. Every 100th rate is also checked against an
+// exhaustive search over all DL, DivAddVal and MulVal values, and must be
+// within 0.1% wherever the hardware can get there. With DL limited to whole
+// values some rates above about 170k have no setting within 0.1%, those are
+// counted and reported. Rates below the 16-bit DL limit, about 101 baud at
+// 204 MHz, must fail. The 204 MHz table must match the solver. Then it times
+// the solver against the floating point search it replaced.
+// Exit code 0 when all checks pass.
+
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+typedef unsigned int UINT32;
+typedef unsigned short UINT16;
+typedef unsigned char UINT8;
+typedef unsigned long long UINT64;
+typedef int BOOL;
+#define TRUE  1
+#define FALSE 0
+#define __section(x)
+
+#define SYSTEM_CLOCK_HZ  204000000
+#define TEST_PCLK        SYSTEM_CLOCK_HZ
+#define MAX_ERROR        0.001   // 0.1%
+#define SWEEP_STEP       1.0002  // Geometric, about 60000 rates
+#define EXHAUSTIVE_EVERY 100     // Rates between exhaustive checks
+
+#include "../LPC43XX_USART_Baud.h"
+
+#define ARRAYSIZE(a)     (sizeof(a) / sizeof(a[0]))
+
+static double BaudError(UINT32 baud, UINT32 dl, UINT32 dav, UINT32 mv)
+{
+    double actual = (double)TEST_PCLK * mv / (16.0 * dl * (mv + dav));
+    return fabs(actual - baud) / baud;
+}
+
+// ---------------------------------------------------------------------------
+// Lowest error of any register setting, trying every DL with every fraction.
+// About 8 million settings, so the sweep calls it only every few rates.
+static double BestError(UINT32 baud)
+{
+    double best = 1e9;
+
+    for (UINT32 mv = 1; mv <= 15; mv++)
+    {
+        for (UINT32 dav = 0; dav < mv; dav++)
+        {
+            for (UINT32 dl = dav ? USART_DL_MIN_FD : 1; dl <= USART_DL_MAX; dl++)
+            {
+                double err = BaudError(baud, dl, dav, mv);
+                if (err < best) best = err;
+            }
+        }
+    }
+    return best;
+}
+
+// ---------------------------------------------------------------------------
+// Floating point search used before USART_BaudSolve(), for the benchmark
+static void BaudFloat(UINT32 BaudRate, UINT16& DL, UINT8& DivAddVal, UINT8& MulVal)
+{
+    DL = TEST_PCLK / (16 * BaudRate);
+    DivAddVal = 0;
+    MulVal = 1;
+    int hit = 0;
+    if ((TEST_PCLK % (16 * BaudRate)) != 0) {
+        float err_best = (float) BaudRate;
+        UINT16 dlmax = DL;
+        for (UINT16 dlv = (dlmax/2); (dlv <= dlmax) && !hit; dlv++) {
+            for (UINT8 mv = 1; mv <= 15; mv++) {
+                for (UINT8 dav = 1; dav < mv; dav++) {
+                    float ratio = 1.0f + ((float) dav / (float) mv);
+                    float calcbaud = (float)TEST_PCLK / (16.0f * (float) dlv * ratio);
+                    float err = fabsf(((float) BaudRate - calcbaud) / (float) BaudRate);
+                    if (err < err_best) {
+                        DL = dlv;
+                        DivAddVal = dav;
+                        MulVal = mv;
+                        err_best = err;
+                        if (err < 0.001f) hit = 1;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+static int CheckSweep()
+{
+    UINT32 lo = 75, hi = TEST_PCLK / 16;
+    UINT32 min = (UINT32)(((UINT64)TEST_PCLK * 15) / ((UINT64)16 * USART_DL_MAX * 29)) + 1;
+    int failures = 0, rates = 0, checked = 0, unreachable = 0;
+    double worst = 0;
+    UINT32 first_unreachable = 0;
+
+    for (double b = lo; b <= hi * SWEEP_STEP; b *= SWEEP_STEP)
+    {
+        UINT32 baud = (b > hi) ? hi : (UINT32)b;
+        UINT16 dl;
+        UINT8 dav, mv;
+        rates++;
+
+        // Below the minimum of CPU_USART_GetBaudrateBoundary() DL overflows
+        if (baud < min)
+        {
+            if (USART_BaudSolve(TEST_PCLK, baud, dl, dav, mv))
+            {
+                printf("FAIL %u: below the minimum %u, got DL %u\n", baud, min, dl);
+                failures++;
+            }
+            continue;
+        }
+        if (!USART_BaudSolve(TEST_PCLK, baud, dl, dav, mv))
+        {
+            printf("FAIL %u: no divisor\n", baud);
+            failures++;
+            continue;
+        }
+        if (dl == 0 || mv < 1 || mv > 15 || dav >= mv || (dav && dl < USART_DL_MIN_FD))
+        {
+            printf("FAIL %u: invalid DL %u DivAddVal %u MulVal %u\n", baud, dl, dav, mv);
+            failures++;
+            continue;
+        }
+
+        if (rates % EXHAUSTIVE_EVERY) continue;
+        checked++;
+
+        // The solver rounds to whole baud, allow for that against the optimum
+        double err = BaudError(baud, dl, dav, mv);
+        double best = BestError(baud);
+        if (err > best + 1.0 / baud)
+        {
+            printf("FAIL %u: error %.5f%%, best %.5f%%\n", baud, 100 * err, 100 * best);
+            failures++;
+        }
+        if (best < MAX_ERROR)
+        {
+            if (err >= MAX_ERROR)
+            {
+                printf("FAIL %u: error %.5f%% over 0.1%%\n", baud, 100 * err);
+                failures++;
+            }
+            if (err > worst) worst = err;
+        }
+        else
+        {
+            // Too few DL values left for the fractions to fill the gaps
+            if (!first_unreachable) first_unreachable = baud;
+            unreachable++;
+        }
+    }
+
+    printf("sweep %u-%u: %d rates, %d exhaustive, minimum %u, worst %.5f%% where 0.1%% is possible\n",
+           lo, hi, rates, checked, min, 100 * worst);
+    printf("sweep: %d checked rates from %u have no setting within 0.1%%\n",
+           unreachable, first_unreachable);
+    return failures;
+}
+
+// ---------------------------------------------------------------------------
+static int CheckTable()
+{
+    int failures = 0;
+
+    for (UINT32 i = 0; i < ARRAYSIZE(USART_BaudTable); i++)
+    {
+        const USART_BAUD_T& t = USART_BaudTable[i];
+        UINT16 dl = 0;
+        UINT8 dav = 0, mv = 0;
+        if (!USART_BaudSolve(TEST_PCLK, t.baud, dl, dav, mv)
+            || dl != t.dl || dav != t.divAddVal || mv != t.mulVal)
+        {
+            printf("FAIL table %u: {%u, %u, %u}, solver {%u, %u, %u}\n",
+                   t.baud, t.dl, t.divAddVal, t.mulVal, dl, dav, mv);
+            failures++;
+        }
+        double err = BaudError(t.baud, t.dl, t.divAddVal, t.mulVal);
+        if (err > BestError(t.baud) + 1.0 / t.baud)
+        {
+            printf("FAIL table %u: error %.5f%% not the best\n", t.baud, 100 * err);
+            failures++;
+        }
+    }
+    printf("table: %u rates\n", (UINT32)ARRAYSIZE(USART_BaudTable));
+    return failures;
+}
+
+// ---------------------------------------------------------------------------
+// Both searches over the same rates, the float one at its worst (few hits)
+static void Benchmark()
+{
+    static const UINT32 rates[] = {75, 110, 300, 1200, 9600, 14400, 19200, 57600,
+                                   115200, 230400, 460800, 921600, 1000000, 3000000};
+    const int rounds = 20;
+    UINT16 dl = 0;
+    UINT8 dav, mv;
+    UINT32 sum = 0;
+
+    clock_t start = clock();
+    for (int r = 0; r < rounds * 1000; r++)
+        for (UINT32 i = 0; i < ARRAYSIZE(rates); i++)
+        {
+            USART_BaudSolve(TEST_PCLK, rates[i] + (r & 1), dl, dav, mv);
+            sum += dl;
+        }
+    double solve = (double)(clock() - start) / CLOCKS_PER_SEC / (rounds * 1000 * ARRAYSIZE(rates));
+
+    start = clock();
+    for (int r = 0; r < rounds; r++)
+        for (UINT32 i = 0; i < ARRAYSIZE(rates); i++)
+        {
+            BaudFloat(rates[i] + (r & 1), dl, dav, mv);
+            sum += dl;
+        }
+    double fp = (double)(clock() - start) / CLOCKS_PER_SEC / (rounds * ARRAYSIZE(rates));
+
+    printf("benchmark: solver %.3f us, float search %.1f us per rate (%u)\n",
+           solve * 1e6, fp * 1e6, sum & 1);
+}
+
+// ---------------------------------------------------------------------------
+int main()
+{
+    int failures = CheckSweep() + CheckTable();
+
+    Benchmark();
+    printf("%s, %d failures\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
@@ -62,24 +62,5 @@ namespace Microsoft.SPOT.Hardware.LPC43XX
             scl = Pins.P2_4;
             sda = Pins.P2_3;
         }
-
-        override public void GetSpiPins(SPI.SPI_module spi_mod, out Cpu.Pin msk, out Cpu.Pin miso, out Cpu.Pin mosi)
-        {
-            switch (spi_mod)
-            {
-                case SPI.SPI_module.SPI1:
-                    msk = Pins.P3_0;
-                    miso = Pins.P1_1;
-                    mosi = Pins.P1_2;
-                    break;
-                case SPI.SPI_module.SPI2:
-                    msk = Pins.PF_4;
-                    miso = Pins.P1_3;
-                    mosi = Pins.P1_4;
-                    break;
-                default:
-                    throw new NotSupportedException();
-            }
-        }
     }
 }
@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////
+// Microsoft_SPOT_Hardware_LPC43XX.cpp - Native method table for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Microsoft_SPOT_Hardware_LPC43XX.h"
+
+// One entry per method in metadata order, methods without a native
+// implementation take a NULL entry. The checksum is the CRC MetaDataProcessor
+// computes over the entry names and must match the assembly, otherwise the
+// CLR refuses to bind it at boot. When the managed methods change, regenerate
+// the table and the stubs from the built assembly and merge them here:
+//
+//   MetaDataProcessor -loadHints mscorlib mscorlib.dll
+//       -parse Microsoft.SPOT.Hardware.LPC43XX.dll
+//       -generate_skeleton Stubs\Microsoft_SPOT_Hardware_LPC43XX
+//                          Microsoft_SPOT_Hardware_LPC43XX Hardware_LPC43XX
+
+static const CLR_RT_MethodHandler method_lookup[] =
+{
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SerialSpan::NativeEnable___STATIC__BOOLEAN__I4__BOOLEAN,
+    Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SerialSpan::NativeAvailable___STATIC__I4__I4,
+    Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SerialSpan::NativeIndexOf___STATIC__I4__I4__U1__I4,
+    Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SerialSpan::NativeRead___STATIC__I4__I4__SZARRAY_U1__I4__I4__BOOLEAN,
+    Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SerialSpan::NativeSkip___STATIC__I4__I4__I4,
+    Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SerialSpan::NativeWrite___STATIC__I4__I4__SZARRAY_U1__I4__I4,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SerialStatistics::NativeGetStatistics___STATIC__BOOLEAN__I4__SZARRAY_U4,
+    Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SerialStatistics::NativeResetStatistics___STATIC__BOOLEAN__I4,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_Sgpio::NativeTransfer___STATIC__BOOLEAN__I4__I4__SZARRAY_U1__I4__I4,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SpiBatch::NativeExecute___STATIC__BOOLEAN__SZARRAY_U4__SZARRAY_OBJECT__SZARRAY_OBJECT__SZARRAY_I4__I4,
+    Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SpiBatch::NativeBenchmark___STATIC__I4__I4__I4__BOOLEAN__I4,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_Spifi::NativeGetInfo___STATIC__VOID__SZARRAY_U4,
+    Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_Spifi::NativeReadKBps___STATIC__I4__I4__I4,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SpiSlave::NativeAvailable___STATIC__I4__I4,
+    Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SpiSlave::NativeRead___STATIC__I4__I4__SZARRAY_U1__I4__I4,
+    Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SpiSlave::NativeWrite___STATIC__I4__I4__SZARRAY_U1__I4__I4,
+};
+
+const CLR_RT_NativeAssemblyData g_CLR_AssemblyNative_Microsoft_SPOT_Hardware_LPC43XX =
+{
+    "Microsoft.SPOT.Hardware.LPC43XX",
+    0xE1691A1F,
+    method_lookup
+};
@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////////////////
+// Microsoft_SPOT_Hardware_LPC43XX.h - Native methods for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _MICROSOFT_SPOT_HARDWARE_LPC43XX_H_
+#define _MICROSOFT_SPOT_HARDWARE_LPC43XX_H_
+
+#include <TinyCLR_Runtime.h>
+
+struct Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SerialStatistics
+{
+    static const int FIELD__BytesIn = 1;
+    static const int FIELD__BytesOut = 2;
+    static const int FIELD__Interrupts = 3;
+    static const int FIELD__RxFifoMax = 4;
+    static const int FIELD__TxFifoMax = 5;
+    static const int FIELD__Overruns = 6;
+    static const int FIELD__FramingErrors = 7;
+    static const int FIELD__ParityErrors = 8;
+    static const int FIELD__Breaks = 9;
+    static const int FIELD__IsrCyclesMax = 10;
+
+    TINYCLR_NATIVE_DECLARE(NativeGetStatistics___STATIC__BOOLEAN__I4__SZARRAY_U4);
+    TINYCLR_NATIVE_DECLARE(NativeResetStatistics___STATIC__BOOLEAN__I4);
+
+    //--//
+};
+
+struct Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SerialSpan
+{
+    TINYCLR_NATIVE_DECLARE(NativeEnable___STATIC__BOOLEAN__I4__BOOLEAN);
+    TINYCLR_NATIVE_DECLARE(NativeAvailable___STATIC__I4__I4);
+    TINYCLR_NATIVE_DECLARE(NativeIndexOf___STATIC__I4__I4__U1__I4);
+    TINYCLR_NATIVE_DECLARE(NativeRead___STATIC__I4__I4__SZARRAY_U1__I4__I4__BOOLEAN);
+    TINYCLR_NATIVE_DECLARE(NativeSkip___STATIC__I4__I4__I4);
+    TINYCLR_NATIVE_DECLARE(NativeWrite___STATIC__I4__I4__SZARRAY_U1__I4__I4);
+
+    //--//
+};
+
+struct Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SpiBatch
+{
+    static const int FIELD___config = 1;
+    static const int FIELD___write = 2;
+    static const int FIELD___read = 3;
+    static const int FIELD___readOffset = 4;
+    static const int FIELD___count = 5;
+
+    TINYCLR_NATIVE_DECLARE(NativeExecute___STATIC__BOOLEAN__SZARRAY_U4__SZARRAY_OBJECT__SZARRAY_OBJECT__SZARRAY_I4__I4);
+    TINYCLR_NATIVE_DECLARE(NativeBenchmark___STATIC__I4__I4__I4__BOOLEAN__I4);
+
+    //--//
+};
+
+struct Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SpiSlave
+{
+    static const int FIELD___port = 1;
+    static const int FIELD___dispatcher = 2;
+    static const int FIELD__FrameReceived = 3;
+
+    TINYCLR_NATIVE_DECLARE(NativeAvailable___STATIC__I4__I4);
+    TINYCLR_NATIVE_DECLARE(NativeRead___STATIC__I4__I4__SZARRAY_U1__I4__I4);
+    TINYCLR_NATIVE_DECLARE(NativeWrite___STATIC__I4__I4__SZARRAY_U1__I4__I4);
+
+    //--//
+};
+
+struct Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_Sgpio
+{
+    static const int FIELD___config = 1;
+    static const int FIELD___clockKHz = 2;
+
+    TINYCLR_NATIVE_DECLARE(NativeTransfer___STATIC__BOOLEAN__I4__I4__SZARRAY_U1__I4__I4);
+
+    //--//
+};
+
+struct Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_Spifi
+{
+    static const int FIELD__JedecId = 1;
+    static const int FIELD__Size = 2;
+    static const int FIELD__ClockKHz = 3;
+    static const int FIELD__ContinuousRead = 4;
+
+    TINYCLR_NATIVE_DECLARE(NativeGetInfo___STATIC__VOID__SZARRAY_U4);
+    TINYCLR_NATIVE_DECLARE(NativeReadKBps___STATIC__I4__I4__I4);
+
+    //--//
+};
+
+extern const CLR_RT_NativeAssemblyData g_CLR_AssemblyNative_Microsoft_SPOT_Hardware_LPC43XX;
+extern const CLR_RT_NativeAssemblyData g_CLR_AssemblyNative_LPC43XX_SpiSlave;
+
+#endif // _MICROSOFT_SPOT_HARDWARE_LPC43XX_H_
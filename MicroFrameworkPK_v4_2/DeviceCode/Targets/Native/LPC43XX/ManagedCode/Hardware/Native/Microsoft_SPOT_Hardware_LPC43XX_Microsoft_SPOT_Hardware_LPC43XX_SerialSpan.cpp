@@ -0,0 +1,160 @@
+////////////////////////////////////////////////////////////////////////////////
+// Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SerialSpan.cpp
+// Direct access to USART DMA buffers for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Microsoft_SPOT_Hardware_LPC43XX.h"
+#include "..\..\..\DeviceCode\LPC43XX_USART\LPC43XX_USART.h"
+
+typedef Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SerialSpan SerialSpan;
+
+// ---------------------------------------------------------------------------
+HRESULT SerialSpan::NativeEnable___STATIC__BOOLEAN__I4__BOOLEAN( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER();
+
+    CLR_INT32 port = stack.Arg0().NumericByRef().s4;
+    BOOL enable = stack.Arg1().NumericByRef().u1 != 0;
+
+    stack.SetResult_Boolean(CPU_USART_SpanEnable(port, enable) == TRUE);
+
+    TINYCLR_NOCLEANUP_NOLABEL();
+}
+
+// ---------------------------------------------------------------------------
+HRESULT SerialSpan::NativeAvailable___STATIC__I4__I4( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER();
+
+    CLR_INT32 port = stack.Arg0().NumericByRef().s4;
+    UINT32 total = 0, len;
+
+    while (CPU_USART_RxSpan(port, total, len)) total += len;
+
+    stack.SetResult_I4(total);
+
+    TINYCLR_NOCLEANUP_NOLABEL();
+}
+
+// ---------------------------------------------------------------------------
+// Searches the received data in place, at most two spans when it wraps
+HRESULT SerialSpan::NativeIndexOf___STATIC__I4__I4__U1__I4( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER();
+
+    CLR_INT32 port = stack.Arg0().NumericByRef().s4;
+    UINT8 value = stack.Arg1().NumericByRef().u1;
+    UINT32 pos = stack.Arg2().NumericByRef().s4;
+    CLR_INT32 result = -1;
+    UINT8 *span;
+    UINT32 len;
+
+    while (result < 0 && (span = CPU_USART_RxSpan(port, pos, len)) != NULL)
+    {
+        for (UINT32 i = 0; i < len; i++)
+        {
+            if (span[i] == value) { result = pos + i; break; }
+        }
+        pos += len;
+    }
+
+    stack.SetResult_I4(result);
+
+    TINYCLR_NOCLEANUP_NOLABEL();
+}
+
+// ---------------------------------------------------------------------------
+// Copies straight from the DMA buffer to the managed array
+HRESULT SerialSpan::NativeRead___STATIC__I4__I4__SZARRAY_U1__I4__I4__BOOLEAN( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER();
+
+    CLR_INT32 port = stack.Arg0().NumericByRef().s4;
+    CLR_RT_HeapBlock_Array* array = stack.Arg1().DereferenceArray(); FAULT_ON_NULL(array);
+    CLR_INT32 offset = stack.Arg2().NumericByRef().s4;
+    CLR_INT32 count = stack.Arg3().NumericByRef().s4;
+    bool consume = stack.Arg4().NumericByRef().u1 != 0;
+    UINT8 *dst, *span;
+    UINT32 done = 0, len;
+
+    if (offset < 0 || count < 0 || (CLR_UINT32)(offset + count) > array->m_numOfElements)
+        TINYCLR_SET_AND_LEAVE(CLR_E_OUT_OF_RANGE);
+
+    dst = array->GetElement(offset);
+    while (done < (UINT32)count && (span = CPU_USART_RxSpan(port, done, len)) != NULL)
+    {
+        if (len > count - done) len = count - done;
+        memcpy(dst + done, span, len);
+        done += len;
+    }
+    if (consume) CPU_USART_RxConsume(port, done);
+
+    stack.SetResult_I4(done);
+
+    TINYCLR_NOCLEANUP();
+}
+
+// ---------------------------------------------------------------------------
+HRESULT SerialSpan::NativeSkip___STATIC__I4__I4__I4( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER();
+
+    CLR_INT32 port = stack.Arg0().NumericByRef().s4;
+    UINT32 count = stack.Arg1().NumericByRef().s4;
+    UINT32 total = 0, len;
+
+    while (total < count && CPU_USART_RxSpan(port, total, len)) total += len;
+    if (total > count) total = count;
+    CPU_USART_RxConsume(port, total);
+
+    stack.SetResult_I4(total);
+
+    TINYCLR_NOCLEANUP_NOLABEL();
+}
+
+// ---------------------------------------------------------------------------
+// Copies straight from the managed array to the DMA staging buffer
+HRESULT SerialSpan::NativeWrite___STATIC__I4__I4__SZARRAY_U1__I4__I4( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER();
+
+    CLR_INT32 port = stack.Arg0().NumericByRef().s4;
+    CLR_RT_HeapBlock_Array* array = stack.Arg1().DereferenceArray(); FAULT_ON_NULL(array);
+    CLR_INT32 offset = stack.Arg2().NumericByRef().s4;
+    CLR_INT32 count = stack.Arg3().NumericByRef().s4;
+    UINT8 *span;
+    UINT32 len;
+
+    if (offset < 0 || count < 0 || (CLR_UINT32)(offset + count) > array->m_numOfElements)
+        TINYCLR_SET_AND_LEAVE(CLR_E_OUT_OF_RANGE);
+
+    span = CPU_USART_TxSpan(port, len);
+    if (span == NULL)
+    {
+        stack.SetResult_I4(0);
+        TINYCLR_SET_AND_LEAVE(S_OK);
+    }
+
+    if (len > (UINT32)count) len = count;
+    memcpy(span, array->GetElement(offset), len);
+    if (!CPU_USART_TxCommit(port, len)) len = 0;
+
+    stack.SetResult_I4(len);
+
+    TINYCLR_NOCLEANUP();
+}
@@ -0,0 +1,56 @@
+////////////////////////////////////////////////////////////////////////////////
+// Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SerialStatistics.cpp
+// USART statistics for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Microsoft_SPOT_Hardware_LPC43XX.h"
+#include "..\..\..\DeviceCode\LPC43XX_USART\LPC43XX_USART.h"
+
+typedef Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SerialStatistics SerialStatistics;
+
+// ---------------------------------------------------------------------------
+HRESULT SerialStatistics::NativeGetStatistics___STATIC__BOOLEAN__I4__SZARRAY_U4( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER();
+
+    USART_STATISTICS stats;
+    CLR_INT32 port = stack.Arg0().NumericByRef().s4;
+    CLR_RT_HeapBlock_Array* array = stack.Arg1().DereferenceArray(); FAULT_ON_NULL(array);
+    BOOL ok;
+
+    if (array->m_numOfElements < USART_STATISTICS_COUNT) TINYCLR_SET_AND_LEAVE(CLR_E_INVALID_PARAMETER);
+
+    ok = CPU_USART_GetStatistics(port, &stats);
+    if (ok) memcpy(array->GetFirstElement(), &stats, sizeof(stats));
+
+    stack.SetResult_Boolean(ok == TRUE);
+
+    TINYCLR_NOCLEANUP();
+}
+
+// ---------------------------------------------------------------------------
+HRESULT SerialStatistics::NativeResetStatistics___STATIC__BOOLEAN__I4( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER();
+
+    CLR_INT32 port = stack.Arg0().NumericByRef().s4;
+
+    stack.SetResult_Boolean(CPU_USART_ResetStatistics(port) == TRUE);
+
+    TINYCLR_NOCLEANUP_NOLABEL();
+}
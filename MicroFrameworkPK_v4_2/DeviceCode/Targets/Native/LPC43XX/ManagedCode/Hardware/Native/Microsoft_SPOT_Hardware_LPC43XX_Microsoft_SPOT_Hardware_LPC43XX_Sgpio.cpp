@@ -0,0 +1,117 @@
+////////////////////////////////////////////////////////////////////////////////
+// Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_Sgpio.cpp
+// SGPIO parallel serial engine for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Microsoft_SPOT_Hardware_LPC43XX.h"
+#include "..\..\..\DeviceCode\LPC43XX_SGPIO\LPC43XX_SGPIO.h"
+
+typedef Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_Sgpio Sgpio;
+
+// The engine has a single transfer, a call made while it runs fails
+static volatile INT32 sgpio_status;
+static HAL_COMPLETION sgpio_done;
+
+// Slack over the time the shifts take, in ms
+#define SGPIO_TIMEOUT_SLACK  100
+
+// ---------------------------------------------------------------------------
+// Wakes the CLR threads waiting on IO events
+static void SGPIO_Done(void* arg)
+{
+    Events_Set(SYSTEM_EVENT_FLAG_IO);
+}
+
+// ---------------------------------------------------------------------------
+// Runs the transfer straight on the managed array, pinned so the GC does not
+// move it, and suspends only the calling thread until it ends. A transfer
+// still pending twice its shift time (plus 100 ms) later is stopped.
+HRESULT Sgpio::NativeTransfer___STATIC__BOOLEAN__I4__I4__SZARRAY_U1__I4__I4( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER();
+
+    CLR_INT32 config = stack.Arg0().NumericByRef().s4;
+    CLR_INT32 clockKHz = stack.Arg1().NumericByRef().s4;
+    CLR_RT_HeapBlock_Array* array = stack.Arg2().DereferenceArray(); FAULT_ON_NULL(array);
+    CLR_INT32 offset = stack.Arg3().NumericByRef().s4;
+    CLR_INT32 count = stack.Arg4().NumericByRef().s4;
+    SGPIO_CONFIGURATION cfg;
+    CLR_RT_HeapBlock hbTimeout;
+    CLR_INT64* timeout;
+    bool fRes = true;
+
+    if (offset < 0 || count < 0 || (CLR_UINT32)(offset + count) > array->m_numOfElements)
+        TINYCLR_SET_AND_LEAVE(CLR_E_OUT_OF_RANGE);
+
+    cfg.Width       = config & 0xFF;
+    cfg.Slices      = (config >> 8) & 0xFF;
+    cfg.ClockKHz    = clockKHz;
+    cfg.ClockInvert = (config & (1 << 16)) ? TRUE : FALSE;
+    cfg.Receive     = (config & (1 << 17)) ? TRUE : FALSE;
+
+    if (cfg.Width == 0 || cfg.ClockKHz <= 0)
+    {
+        stack.SetResult_Boolean(false);
+        TINYCLR_SET_AND_LEAVE(S_OK);
+    }
+
+    // Count * 8 / Width shifts at ClockKHz, twice that in ms. The first call
+    // pushes the expiry time, calls resumed after a wait reuse it.
+    hbTimeout.SetInteger((CLR_INT32)(SGPIO_TIMEOUT_SLACK
+                         + (INT64)count * 8 / cfg.Width * 2 / cfg.ClockKHz));
+    TINYCLR_CHECK_HRESULT(stack.SetupTimeout(hbTimeout, timeout));
+
+    if (stack.m_customState == 1)
+    {
+        if (SGPIO_Busy())
+        {
+            stack.PopValue(); // Timeout
+            stack.SetResult_Boolean(false);
+            TINYCLR_SET_AND_LEAVE(S_OK);
+        }
+
+        sgpio_done.InitializeForUserMode(SGPIO_Done, NULL);
+        array->Pin();
+        if (!SGPIO_Transfer(cfg, array->GetElement(offset), count, &sgpio_status, &sgpio_done))
+        {
+            array->Unpin();
+            stack.PopValue(); // Timeout
+            stack.SetResult_Boolean(false);
+            TINYCLR_SET_AND_LEAVE(S_OK);
+        }
+        stack.m_customState = 2;
+    }
+
+    while (sgpio_status == SGPIO_PENDING)
+    {
+        // Returns CLR_E_THREAD_WAITING, the call resumes on an IO event
+        TINYCLR_CHECK_HRESULT(g_CLR_RT_ExecutionEngine.WaitEvents(stack.m_owningThread, *timeout,
+                                                                  CLR_RT_ExecutionEngine::c_Event_IO, fRes));
+        if (!fRes)
+        {
+            SGPIO_Stop();
+            break;
+        }
+    }
+
+    array->Unpin();
+    stack.PopValue(); // Timeout
+    stack.SetResult_Boolean(sgpio_status == SGPIO_DONE);
+
+    TINYCLR_NOCLEANUP();
+}
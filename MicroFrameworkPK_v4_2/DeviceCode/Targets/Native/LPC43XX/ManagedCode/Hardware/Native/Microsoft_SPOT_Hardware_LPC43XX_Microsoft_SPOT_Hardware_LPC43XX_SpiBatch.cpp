@@ -0,0 +1,155 @@
+////////////////////////////////////////////////////////////////////////////////
+// Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SpiBatch.cpp
+// Batched SPI transactions for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Microsoft_SPOT_Hardware_LPC43XX.h"
+#include "..\..\..\DeviceCode\LPC43XX_SPI\LPC43XX_SPI.h"
+
+typedef Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SpiBatch SpiBatch;
+
+// Words per entry in the packed configuration, must match SpiBatch.cs
+#define SPI_BATCH_CONFIG_WORDS  8
+
+// Managed calls run one at a time, so a single descriptor table is enough
+static SPI_ASYNC_XACTION spi_batch[LPC43XX_SPI_BATCH_MAX];
+
+// Slack over the time the batch takes, in 100 ns ticks
+#define SPI_BATCH_TIMEOUT_SLACK  (100 * 10000)
+
+// ---------------------------------------------------------------------------
+// Returns the byte array in element i of an object array, NULL if empty
+static HRESULT SPI_BatchBuffer(CLR_RT_HeapBlock_Array* list, int i, CLR_RT_HeapBlock_Array*& buf)
+{
+    TINYCLR_HEADER();
+
+    buf = ((CLR_RT_HeapBlock*)list->GetFirstElement())[i].DereferenceArray();
+    if (buf && buf->m_typeOfElement != DATATYPE_U1) TINYCLR_SET_AND_LEAVE(CLR_E_WRONG_TYPE);
+
+    TINYCLR_NOCLEANUP();
+}
+
+// ---------------------------------------------------------------------------
+// Queues the whole batch on the async engine and waits for the last entry
+// with interrupts enabled. Managed buffers do not move during the call. A
+// batch still pending twice its frame and CS time (plus 100 ms) later is
+// cancelled.
+HRESULT SpiBatch::NativeExecute___STATIC__BOOLEAN__SZARRAY_U4__SZARRAY_OBJECT__SZARRAY_OBJECT__SZARRAY_I4__I4( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER();
+
+    CLR_RT_HeapBlock_Array* config = stack.Arg0().DereferenceArray(); FAULT_ON_NULL(config);
+    CLR_RT_HeapBlock_Array* writes = stack.Arg1().DereferenceArray(); FAULT_ON_NULL(writes);
+    CLR_RT_HeapBlock_Array* reads = stack.Arg2().DereferenceArray(); FAULT_ON_NULL(reads);
+    CLR_RT_HeapBlock_Array* offsets = stack.Arg3().DereferenceArray(); FAULT_ON_NULL(offsets);
+    CLR_INT32 count = stack.Arg4().NumericByRef().s4;
+    CLR_RT_HeapBlock_Array *w, *r;
+    CLR_UINT32* cfg;
+    CLR_INT32* off;
+    INT64 timeout = SPI_BATCH_TIMEOUT_SLACK;
+    bool ok = true;
+
+    if (count <= 0 || count > LPC43XX_SPI_BATCH_MAX ||
+        config->m_numOfElements < (CLR_UINT32)(count * SPI_BATCH_CONFIG_WORDS) ||
+        writes->m_numOfElements < (CLR_UINT32)count || reads->m_numOfElements < (CLR_UINT32)count ||
+        offsets->m_numOfElements < (CLR_UINT32)count)
+    {
+        stack.SetResult_Boolean(false);
+        TINYCLR_SET_AND_LEAVE(S_OK);
+    }
+
+    cfg = (CLR_UINT32*)config->GetFirstElement();
+    off = (CLR_INT32*)offsets->GetFirstElement();
+    for (int i = 0; i < count; i++, cfg += SPI_BATCH_CONFIG_WORDS)
+    {
+        SPI_ASYNC_XACTION *x = &spi_batch[i];
+
+        TINYCLR_CHECK_HRESULT(SPI_BatchBuffer(writes, i, w));
+        TINYCLR_CHECK_HRESULT(SPI_BatchBuffer(reads, i, r));
+
+        x->Configuration.DeviceCS        = (GPIO_PIN)cfg[0];
+        x->Configuration.CS_Active       = (cfg[1] != 0);
+        x->Configuration.CS_Setup_uSecs  = cfg[2];
+        x->Configuration.CS_Hold_uSecs   = cfg[3];
+        x->Configuration.MSK_IDLE        = (cfg[4] != 0);
+        x->Configuration.MSK_SampleEdge  = (cfg[5] != 0);
+        x->Configuration.Clock_RateKHz   = cfg[6];
+        x->Configuration.SPI_mod         = cfg[7];
+        x->Configuration.MD_16bits       = FALSE;
+        x->Configuration.BusyPin.Pin     = GPIO_PIN_NONE;
+        x->Write           = (w) ? w->GetFirstElement() : NULL;
+        x->WriteCount      = (w) ? w->m_numOfElements : 0;
+        x->Read            = (r) ? r->GetFirstElement() : NULL;
+        x->ReadCount       = (r) ? r->m_numOfElements : 0;
+        x->ReadStartOffset = off[i];
+
+        // Frames of 8 bits at Clock_RateKHz and the CS waits, twice that
+        if (x->Configuration.Clock_RateKHz)
+        {
+            timeout += (INT64)((x->ReadCount) ? x->ReadCount + x->ReadStartOffset : x->WriteCount)
+                       * 8 * 20000 / x->Configuration.Clock_RateKHz;
+        }
+        timeout += (INT64)(x->Configuration.CS_Setup_uSecs + x->Configuration.CS_Hold_uSecs) * 20;
+    }
+
+    if (!CPU_SPI_Async_Batch(spi_batch, count, NULL))
+    {
+        stack.SetResult_Boolean(false);
+        TINYCLR_SET_AND_LEAVE(S_OK);
+    }
+
+    timeout += HAL_Time_CurrentTicks();
+    while (spi_batch[count - 1].Status == SPI_ASYNC_PENDING)
+    {
+        if (HAL_Time_CurrentTicks() > timeout)
+        {
+            CPU_SPI_Async_Cancel(spi_batch[0].Configuration.SPI_mod);
+            break;
+        }
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (spi_batch[i].Status != SPI_ASYNC_DONE) ok = false;
+    }
+
+    stack.SetResult_Boolean(ok);
+
+    TINYCLR_NOCLEANUP();
+}
+
+// ---------------------------------------------------------------------------
+// Bit rate of the polled engine, 0 if the port or arguments are rejected
+HRESULT SpiBatch::NativeBenchmark___STATIC__I4__I4__I4__BOOLEAN__I4( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER();
+
+    CLR_INT32 port = stack.Arg0().NumericByRef().s4;
+    CLR_INT32 khz = stack.Arg1().NumericByRef().s4;
+    bool wide = stack.Arg2().NumericByRef().u1 != 0;
+    CLR_INT32 frames = stack.Arg3().NumericByRef().s4;
+
+    if (port < 0 || khz <= 0)
+    {
+        stack.SetResult_I4(0);
+        TINYCLR_SET_AND_LEAVE(S_OK);
+    }
+
+    stack.SetResult_I4((CLR_INT32)CPU_SPI_Benchmark(port, khz, wide, frames));
+
+    TINYCLR_NOCLEANUP();
+}
@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////////////////////
+// Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SpiSlave.cpp
+// SPI slave mode for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Microsoft_SPOT_Hardware_LPC43XX.h"
+#include <TinyCLR_Interop.h>
+#include "..\..\..\DeviceCode\LPC43XX_SPI\LPC43XX_SPI.h"
+
+typedef Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_SpiSlave SpiSlave;
+
+// NativeEventDispatcher driver "LPC43XX_SpiSlave". User data holds the
+// SPI_mod in bits 0-7 and the SPI mode in bits 8-9.
+#define SPI_SLAVE_PORTS  2  // SSP0, SSP1
+
+typedef struct
+{
+  CLR_RT_HeapBlock_NativeEventDispatcher* context;
+  BOOL enabled;
+} SPI_SLAVE_EVENT_T;
+
+static SPI_SLAVE_EVENT_T spi_slave_event[SPI_SLAVE_PORTS];
+
+// ---------------------------------------------------------------------------
+// Frame callback, runs in the SSEL interrupt
+static void SPI_SlaveFrame(void* Param, UINT32 Length, UINT32 Overruns)
+{
+    SPI_SLAVE_EVENT_T *ev = &spi_slave_event[(int)Param];
+
+    if (ev->context && ev->enabled) SaveNativeEventToHALQueue(ev->context, Length, Overruns);
+}
+
+// ---------------------------------------------------------------------------
+static HRESULT SPI_SlaveInitialize(CLR_RT_HeapBlock_NativeEventDispatcher* pContext, UINT64 userData)
+{
+    TINYCLR_HEADER();
+
+    UINT32 port = (UINT32)userData & 0xFF;
+    UINT32 mode = ((UINT32)userData >> 8) & 0x03;
+
+    if (port >= SPI_SLAVE_PORTS || spi_slave_event[port].context) TINYCLR_SET_AND_LEAVE(CLR_E_INVALID_PARAMETER);
+
+    spi_slave_event[port].context = pContext;
+    spi_slave_event[port].enabled = FALSE;
+    if (!CPU_SPI_Slave_Start(port, mode, SPI_SlaveFrame, (void*)port))
+    {
+        spi_slave_event[port].context = NULL;
+        TINYCLR_SET_AND_LEAVE(CLR_E_NOT_SUPPORTED);
+    }
+
+    TINYCLR_NOCLEANUP();
+}
+
+// ---------------------------------------------------------------------------
+static HRESULT SPI_SlaveEnableDisable(CLR_RT_HeapBlock_NativeEventDispatcher* pContext, bool fEnable)
+{
+    for (int i = 0; i < SPI_SLAVE_PORTS; i++)
+    {
+        if (spi_slave_event[i].context == pContext) spi_slave_event[i].enabled = fEnable;
+    }
+    return S_OK;
+}
+
+// ---------------------------------------------------------------------------
+static HRESULT SPI_SlaveCleanup(CLR_RT_HeapBlock_NativeEventDispatcher* pContext)
+{
+    for (int i = 0; i < SPI_SLAVE_PORTS; i++)
+    {
+        if (spi_slave_event[i].context != pContext) continue;
+        CPU_SPI_Slave_Stop(i);
+        spi_slave_event[i].context = NULL;
+        spi_slave_event[i].enabled = FALSE;
+    }
+    CleanupNativeEventsFromHALQueue(pContext);
+    return S_OK;
+}
+
+static const CLR_RT_DriverInterruptMethods g_LPC43XX_SpiSlaveDriverMethods =
+{
+    SPI_SlaveInitialize,
+    SPI_SlaveEnableDisable,
+    SPI_SlaveCleanup
+};
+
+const CLR_RT_NativeAssemblyData g_CLR_AssemblyNative_LPC43XX_SpiSlave =
+{
+    "LPC43XX_SpiSlave",
+    DRIVER_INTERRUPT_METHODS_CHECKSUM,
+    &g_LPC43XX_SpiSlaveDriverMethods
+};
+
+// ---------------------------------------------------------------------------
+HRESULT SpiSlave::NativeAvailable___STATIC__I4__I4( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER();
+
+    CLR_INT32 port = stack.Arg0().NumericByRef().s4;
+    UINT32 total = 0, len;
+
+    while (CPU_SPI_Slave_RxSpan(port, total, len)) total += len;
+
+    stack.SetResult_I4(total);
+
+    TINYCLR_NOCLEANUP_NOLABEL();
+}
+
+// ---------------------------------------------------------------------------
+// Copies straight from the DMA ring to the managed array
+HRESULT SpiSlave::NativeRead___STATIC__I4__I4__SZARRAY_U1__I4__I4( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER();
+
+    CLR_INT32 port = stack.Arg0().NumericByRef().s4;
+    CLR_RT_HeapBlock_Array* array = stack.Arg1().DereferenceArray(); FAULT_ON_NULL(array);
+    CLR_INT32 offset = stack.Arg2().NumericByRef().s4;
+    CLR_INT32 count = stack.Arg3().NumericByRef().s4;
+    UINT8 *dst, *span;
+    UINT32 done = 0, len;
+
+    if (offset < 0 || count < 0 || (CLR_UINT32)(offset + count) > array->m_numOfElements)
+        TINYCLR_SET_AND_LEAVE(CLR_E_OUT_OF_RANGE);
+
+    dst = array->GetElement(offset);
+    while (done < (UINT32)count && (span = CPU_SPI_Slave_RxSpan(port, done, len)) != NULL)
+    {
+        if (len > count - done) len = count - done;
+        memcpy(dst + done, span, len);
+        done += len;
+    }
+    CPU_SPI_Slave_RxConsume(port, done);
+
+    stack.SetResult_I4(done);
+
+    TINYCLR_NOCLEANUP();
+}
+
+// ---------------------------------------------------------------------------
+HRESULT SpiSlave::NativeWrite___STATIC__I4__I4__SZARRAY_U1__I4__I4( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER();
+
+    CLR_INT32 port = stack.Arg0().NumericByRef().s4;
+    CLR_RT_HeapBlock_Array* array = stack.Arg1().DereferenceArray(); FAULT_ON_NULL(array);
+    CLR_INT32 offset = stack.Arg2().NumericByRef().s4;
+    CLR_INT32 count = stack.Arg3().NumericByRef().s4;
+
+    if (offset < 0 || count < 0 || (CLR_UINT32)(offset + count) > array->m_numOfElements)
+        TINYCLR_SET_AND_LEAVE(CLR_E_OUT_OF_RANGE);
+
+    stack.SetResult_I4(CPU_SPI_Slave_Write(port, array->GetElement(offset), count));
+
+    TINYCLR_NOCLEANUP();
+}
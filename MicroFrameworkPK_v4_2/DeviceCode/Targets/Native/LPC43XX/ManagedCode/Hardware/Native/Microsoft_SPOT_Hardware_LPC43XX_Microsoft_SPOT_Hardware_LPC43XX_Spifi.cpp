@@ -0,0 +1,61 @@
+////////////////////////////////////////////////////////////////////////////////
+// Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_Spifi.cpp
+// SPIFI flash information for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Microsoft_SPOT_Hardware_LPC43XX.h"
+#include "..\..\..\DeviceCode\LPC43XX_SPIFI\LPC43XX_SPIFI.h"
+
+typedef Library_Microsoft_SPOT_Hardware_LPC43XX_Microsoft_SPOT_Hardware_LPC43XX_Spifi Spifi;
+
+// ---------------------------------------------------------------------------
+HRESULT Spifi::NativeGetInfo___STATIC__VOID__SZARRAY_U4( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER();
+
+    const SPIFI_FLASH_INFO* flash = SPIFI_GetFlashInfo();
+    CLR_RT_HeapBlock_Array* array = stack.Arg0().DereferenceArray(); FAULT_ON_NULL(array);
+    CLR_UINT32* info;
+
+    if (array->m_numOfElements < 4) TINYCLR_SET_AND_LEAVE(CLR_E_INVALID_PARAMETER);
+
+    info = (CLR_UINT32*)array->GetFirstElement();
+    info[0] = flash->JedecId;
+    info[1] = flash->Size;
+    info[2] = flash->ClockKHz;
+    info[3] = (flash->ReadIdata == IDATA_NO_OPCODE);
+
+    TINYCLR_NOCLEANUP();
+}
+
+// ---------------------------------------------------------------------------
+HRESULT Spifi::NativeReadKBps___STATIC__I4__I4__I4( CLR_RT_StackFrame& stack )
+{
+    TINYCLR_HEADER();
+
+    const SPIFI_FLASH_INFO* flash = SPIFI_GetFlashInfo();
+    CLR_INT32 offset = stack.Arg0().NumericByRef().s4;
+    CLR_INT32 length = stack.Arg1().NumericByRef().s4;
+
+    if (offset < 0 || length <= 0 || (CLR_UINT32)offset + length > flash->Size)
+        stack.SetResult_I4(-1);
+    else
+        stack.SetResult_I4(SPIFI_ReadKBps(FLASH_MEMORY_Base + offset, length));
+
+    TINYCLR_NOCLEANUP_NOLABEL();
+}
@@ -0,0 +1,125 @@
+////////////////////////////////////////////////////////////////////////////////
+// SerialSpan.cs - Direct access to USART DMA buffers for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+using System;
+using System.Runtime.CompilerServices;
+
+namespace Microsoft.SPOT.Hardware.LPC43XX
+{
+    /// <summary>
+    /// Reads and writes a serial port directly from its DMA buffers. Received
+    /// data bypasses the SerialPort queue, so frames can be located with
+    /// IndexOf and copied once into the caller's buffer. The port must be
+    /// open and configured for DMA receive and transmit.
+    /// </summary>
+    public static class SerialSpan
+    {
+        /// <summary>
+        /// Enables span mode. While enabled SerialPort.Read returns no data.
+        /// </summary>
+        public static void Enable(string comPort, bool enable)
+        {
+            if (!NativeEnable(SerialStatistics.PortIndex(comPort), enable))
+                throw new NotSupportedException();
+        }
+
+        /// <summary>
+        /// Number of received bytes not yet consumed.
+        /// </summary>
+        public static int Available(string comPort)
+        {
+            return NativeAvailable(SerialStatistics.PortIndex(comPort));
+        }
+
+        /// <summary>
+        /// Position of the first received byte equal to value at or after
+        /// offset, or -1 if not found. Nothing is consumed.
+        /// </summary>
+        public static int IndexOf(string comPort, byte value, int offset)
+        {
+            if (offset < 0) throw new ArgumentOutOfRangeException();
+            return NativeIndexOf(SerialStatistics.PortIndex(comPort), value, offset);
+        }
+
+        /// <summary>
+        /// Copies up to count received bytes and consumes them.
+        /// </summary>
+        public static int Read(string comPort, byte[] buffer, int offset, int count)
+        {
+            return Copy(comPort, buffer, offset, count, true);
+        }
+
+        /// <summary>
+        /// Copies up to count received bytes without consuming them.
+        /// </summary>
+        public static int Peek(string comPort, byte[] buffer, int offset, int count)
+        {
+            return Copy(comPort, buffer, offset, count, false);
+        }
+
+        /// <summary>
+        /// Consumes up to count received bytes without copying them.
+        /// </summary>
+        public static int Skip(string comPort, int count)
+        {
+            if (count < 0) throw new ArgumentOutOfRangeException();
+            return NativeSkip(SerialStatistics.PortIndex(comPort), count);
+        }
+
+        /// <summary>
+        /// Copies up to count bytes into the DMA staging buffer and starts the
+        /// transfer. Returns the number of bytes sent, 0 if the buffer is busy.
+        /// </summary>
+        public static int Write(string comPort, byte[] buffer, int offset, int count)
+        {
+            CheckRange(buffer, offset, count);
+            return NativeWrite(SerialStatistics.PortIndex(comPort), buffer, offset, count);
+        }
+
+        private static int Copy(string comPort, byte[] buffer, int offset, int count, bool consume)
+        {
+            CheckRange(buffer, offset, count);
+            return NativeRead(SerialStatistics.PortIndex(comPort), buffer, offset, count, consume);
+        }
+
+        private static void CheckRange(byte[] buffer, int offset, int count)
+        {
+            if (buffer == null) throw new ArgumentNullException();
+            if (offset < 0 || count < 0 || offset + count > buffer.Length)
+                throw new ArgumentOutOfRangeException();
+        }
+
+        [MethodImplAttribute(MethodImplOptions.InternalCall)]
+        private static extern bool NativeEnable(int port, bool enable);
+
+        [MethodImplAttribute(MethodImplOptions.InternalCall)]
+        private static extern int NativeAvailable(int port);
+
+        [MethodImplAttribute(MethodImplOptions.InternalCall)]
+        private static extern int NativeIndexOf(int port, byte value, int offset);
+
+        [MethodImplAttribute(MethodImplOptions.InternalCall)]
+        private static extern int NativeRead(int port, byte[] buffer, int offset, int count, bool consume);
+
+        [MethodImplAttribute(MethodImplOptions.InternalCall)]
+        private static extern int NativeSkip(int port, int count);
+
+        [MethodImplAttribute(MethodImplOptions.InternalCall)]
+        private static extern int NativeWrite(int port, byte[] buffer, int offset, int count);
+    }
+}
@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////////////
+// SerialStatistics.cs - USART statistics for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+using System;
+using System.Runtime.CompilerServices;
+
+namespace Microsoft.SPOT.Hardware.LPC43XX
+{
+    /// <summary>
+    /// Throughput and error counters for a serial port.
+    /// </summary>
+    public sealed class SerialStatistics
+    {
+        // Must match USART_STATISTICS in LPC43XX_USART.h
+        private const int StatisticsCount = 10;
+
+        public uint BytesIn;
+        public uint BytesOut;
+        public uint Interrupts;
+        public uint RxFifoMax;      // Most characters received in one interrupt or DMA span
+        public uint TxFifoMax;      // Most characters sent in one interrupt or DMA span
+        public uint Overruns;
+        public uint FramingErrors;
+        public uint ParityErrors;
+        public uint Breaks;
+        public uint IsrCyclesMax;   // Longest USART ISR in CPU cycles
+
+        /// <summary>
+        /// Reads the counters for a port ("COM1".."COM4").
+        /// </summary>
+        public static SerialStatistics Get(string comPort)
+        {
+            uint[] data = new uint[StatisticsCount];
+
+            if (!NativeGetStatistics(PortIndex(comPort), data))
+                throw new ArgumentException();
+
+            SerialStatistics stats = new SerialStatistics();
+            stats.BytesIn = data[0];
+            stats.BytesOut = data[1];
+            stats.Interrupts = data[2];
+            stats.RxFifoMax = data[3];
+            stats.TxFifoMax = data[4];
+            stats.Overruns = data[5];
+            stats.FramingErrors = data[6];
+            stats.ParityErrors = data[7];
+            stats.Breaks = data[8];
+            stats.IsrCyclesMax = data[9];
+            return stats;
+        }
+
+        /// <summary>
+        /// Clears the counters for a port.
+        /// </summary>
+        public static void Reset(string comPort)
+        {
+            if (!NativeResetStatistics(PortIndex(comPort)))
+                throw new ArgumentException();
+        }
+
+        internal static int PortIndex(string comPort)
+        {
+            if (comPort == null || comPort.Length != 4 || !comPort.Substring(0, 3).Equals("COM"))
+                throw new ArgumentException();
+            return comPort[3] - '1';
+        }
+
+        [MethodImplAttribute(MethodImplOptions.InternalCall)]
+        private static extern bool NativeGetStatistics(int port, uint[] stats);
+
+        [MethodImplAttribute(MethodImplOptions.InternalCall)]
+        private static extern bool NativeResetStatistics(int port);
+    }
+}
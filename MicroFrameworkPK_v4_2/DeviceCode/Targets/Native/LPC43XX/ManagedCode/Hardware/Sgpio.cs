@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////////////////
+// Sgpio.cs - SGPIO parallel serial engine for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+using System;
+using System.Runtime.CompilerServices;
+
+namespace Microsoft.SPOT.Hardware.LPC43XX
+{
+    /// <summary>
+    /// Synchronous lanes on the SGPIO block. Width lanes (1, 2, 4 or 8) on
+    /// SGPIO0 and up shift together on the clock driven out on SGPIO8. Each
+    /// byte holds 8 / Width frames, LSB first, lane n is bit n of a frame.
+    /// With 8 lanes this is an 8 bit parallel bus, with fewer it drives that
+    /// many SPI style data lines at once. Transfers must be a whole number of
+    /// blocks. Larger slice chains mean fewer interrupts per byte. A block
+    /// must last at least 1024 core cycles, so fast clocks need more slices,
+    /// and the rate tops out near 6.4 MB/s with 8 slices (0.8 MB/s with 1)
+    /// at 204 MHz. Other threads run while a transfer is in progress, only
+    /// one transfer runs at a time. Transfers throw InvalidOperationException
+    /// when the clock is too fast, another transfer is running, an interrupt
+    /// was served too late or the transfer timed out.
+    /// </summary>
+    public sealed class Sgpio
+    {
+        private readonly int _config;
+        private readonly int _clockKHz;
+
+        /// <summary>
+        /// Lanes, chained slices (1, 2, 4 or 8) and shift clock. clockInvert
+        /// shifts on the falling edge of SGPIO8.
+        /// </summary>
+        public Sgpio(int width, int slices, int clockKHz, bool clockInvert)
+        {
+            if (!IsPowerOfTwo(width) || !IsPowerOfTwo(slices) || clockKHz <= 0)
+                throw new ArgumentOutOfRangeException();
+
+            _config = width | (slices << 8) | (clockInvert ? 1 << 16 : 0);
+            _clockKHz = clockKHz;
+        }
+
+        /// <summary>
+        /// Bytes moved per interrupt, transfer counts are a multiple of it.
+        /// </summary>
+        public int BlockSize
+        {
+            get { return 4 * ((_config >> 8) & 0xFF); }
+        }
+
+        /// <summary>
+        /// Clocks count bytes out on the lanes and returns when done.
+        /// </summary>
+        public void Write(byte[] buffer, int offset, int count)
+        {
+            Transfer(buffer, offset, count, false);
+        }
+
+        /// <summary>
+        /// Clocks count bytes in from the lanes and returns when done.
+        /// </summary>
+        public void Read(byte[] buffer, int offset, int count)
+        {
+            Transfer(buffer, offset, count, true);
+        }
+
+        private void Transfer(byte[] buffer, int offset, int count, bool receive)
+        {
+            if (buffer == null) throw new ArgumentNullException();
+            if (offset < 0 || count < 0 || offset + count > buffer.Length || count % BlockSize != 0)
+                throw new ArgumentOutOfRangeException();
+            if (count == 0) return;
+
+            if (!NativeTransfer(_config | (receive ? 1 << 17 : 0), _clockKHz, buffer, offset, count))
+                throw new InvalidOperationException();
+        }
+
+        private static bool IsPowerOfTwo(int n)
+        {
+            return n == 1 || n == 2 || n == 4 || n == 8;
+        }
+
+        [MethodImplAttribute(MethodImplOptions.InternalCall)]
+        private static extern bool NativeTransfer(int config, int clockKHz, byte[] buffer, int offset, int count);
+    }
+}
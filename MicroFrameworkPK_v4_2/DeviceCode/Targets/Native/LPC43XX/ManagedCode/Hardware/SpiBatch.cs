@@ -0,0 +1,131 @@
+////////////////////////////////////////////////////////////////////////////////
+// SpiBatch.cs - Batched SPI transactions for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+using System;
+using System.Runtime.CompilerServices;
+
+namespace Microsoft.SPOT.Hardware.LPC43XX
+{
+    /// <summary>
+    /// A list of 8 bit SPI transactions run back to back in a single native
+    /// call. Entries may address different chip selects on the same SPI
+    /// module. Chip select setup and hold times are honored per entry.
+    /// </summary>
+    public sealed class SpiBatch
+    {
+        // Words per entry in the packed configuration, must match the native side
+        private const int ConfigWords = 8;
+
+        private readonly uint[] _config;
+        private readonly object[] _write;
+        private readonly object[] _read;
+        private readonly int[] _readOffset;
+        private int _count;
+
+        public SpiBatch(int capacity)
+        {
+            if (capacity <= 0) throw new ArgumentOutOfRangeException();
+
+            _config = new uint[capacity * ConfigWords];
+            _write = new object[capacity];
+            _read = new object[capacity];
+            _readOffset = new int[capacity];
+        }
+
+        /// <summary>
+        /// Number of transactions in the batch.
+        /// </summary>
+        public int Count
+        {
+            get { return _count; }
+        }
+
+        /// <summary>
+        /// Appends a transaction, same semantics as SPI.WriteRead. Either
+        /// buffer may be null but not both. Returns its index.
+        /// </summary>
+        public int Add(SPI.Configuration config, byte[] write, byte[] read, int readOffset)
+        {
+            if (config == null) throw new ArgumentNullException();
+            if (write == null && read == null) throw new ArgumentNullException();
+            if (readOffset < 0) throw new ArgumentOutOfRangeException();
+            if (_count == _readOffset.Length) throw new InvalidOperationException();
+
+            int i = _count * ConfigWords;
+            _config[i + 0] = (uint)config.ChipSelect_Port;
+            _config[i + 1] = config.ChipSelect_ActiveState ? 1u : 0u;
+            _config[i + 2] = config.ChipSelect_SetupTime;
+            _config[i + 3] = config.ChipSelect_HoldTime;
+            _config[i + 4] = config.Clock_IdleState ? 1u : 0u;
+            _config[i + 5] = config.Clock_Edge ? 1u : 0u;
+            _config[i + 6] = config.Clock_RateKHz;
+            _config[i + 7] = (uint)config.SPI_mod;
+
+            _write[_count] = write;
+            _read[_count] = read;
+            _readOffset[_count] = readOffset;
+            return _count++;
+        }
+
+        /// <summary>
+        /// Removes all transactions. Buffers are no longer referenced.
+        /// </summary>
+        public void Clear()
+        {
+            for (int i = 0; i < _count; i++)
+            {
+                _write[i] = null;
+                _read[i] = null;
+            }
+            _count = 0;
+        }
+
+        /// <summary>
+        /// Runs the transactions in order and returns when the last one is
+        /// done. Throws if the batch is rejected, a transfer fails or the
+        /// batch takes more than twice its expected time and is cancelled.
+        /// </summary>
+        public void Execute()
+        {
+            if (_count == 0) return;
+            if (!NativeExecute(_config, _write, _read, _readOffset, _count))
+                throw new InvalidOperationException();
+        }
+
+        /// <summary>
+        /// Effective bit rate of the SSP FIFO engine for frames (up to 512)
+        /// 8 or 16 bit frames at clockKHz, in loopback mode. SCK and MOSI
+        /// still toggle on the port pins, so keep every device deselected.
+        /// </summary>
+        public static int Benchmark(SPI.SPI_module module, int clockKHz, bool wide, int frames)
+        {
+            if (clockKHz <= 0 || frames <= 0 || frames > 512) throw new ArgumentOutOfRangeException();
+
+            int bps = NativeBenchmark((int)module, clockKHz, wide, frames);
+            if (bps == 0)
+                throw new InvalidOperationException();
+            return bps;
+        }
+
+        [MethodImplAttribute(MethodImplOptions.InternalCall)]
+        private static extern bool NativeExecute(uint[] config, object[] write, object[] read, int[] readOffset, int count);
+
+        [MethodImplAttribute(MethodImplOptions.InternalCall)]
+        private static extern int NativeBenchmark(int port, int clockKHz, bool wide, int frames);
+    }
+}
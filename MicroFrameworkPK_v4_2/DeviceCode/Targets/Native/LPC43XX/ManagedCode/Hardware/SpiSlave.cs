@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////////////////
+// SpiSlave.cs - SPI slave mode for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+using System;
+using System.Runtime.CompilerServices;
+
+namespace Microsoft.SPOT.Hardware.LPC43XX
+{
+    /// <summary>
+    /// Raised once per frame, when the master deasserts SSEL. Length bytes
+    /// are available to Read. Overruns counts ring segments dropped so far.
+    /// </summary>
+    public delegate void SpiFrameEventHandler(SpiSlave sender, int length, int overruns, DateTime time);
+
+    /// <summary>
+    /// Runs an SSP port as an 8 bit SPI slave. Received frames are buffered
+    /// by DMA and reported with FrameReceived. Bytes queued with Write are
+    /// clocked out by the master as a continuous stream. The port must be
+    /// configured for DMA, SCK is limited to 1/12 of the SSP clock.
+    /// </summary>
+    public sealed class SpiSlave : IDisposable
+    {
+        private readonly int _port;
+        private readonly NativeEventDispatcher _dispatcher;
+
+        public event SpiFrameEventHandler FrameReceived;
+
+        /// <summary>
+        /// Starts slave mode with the same clock settings as SPI.Configuration.
+        /// </summary>
+        public SpiSlave(SPI.SPI_module module, bool clockIdleState, bool clockEdge)
+        {
+            int mode = (clockIdleState ? 2 : 0) | (clockEdge ? 0 : 1);
+
+            _port = (int)module;
+            _dispatcher = new NativeEventDispatcher("LPC43XX_SpiSlave", (ulong)(_port | (mode << 8)));
+            _dispatcher.OnInterrupt += OnFrame;
+        }
+
+        /// <summary>
+        /// Number of received bytes in completed frames not yet read.
+        /// </summary>
+        public int Available
+        {
+            get { return NativeAvailable(_port); }
+        }
+
+        /// <summary>
+        /// Copies up to count received bytes and consumes them.
+        /// </summary>
+        public int Read(byte[] buffer, int offset, int count)
+        {
+            CheckRange(buffer, offset, count);
+            return NativeRead(_port, buffer, offset, count);
+        }
+
+        /// <summary>
+        /// Queues up to count bytes for the master to read. Returns the
+        /// number queued, less than count when the TX ring is full.
+        /// </summary>
+        public int Write(byte[] buffer, int offset, int count)
+        {
+            CheckRange(buffer, offset, count);
+            return NativeWrite(_port, buffer, offset, count);
+        }
+
+        public void Dispose()
+        {
+            _dispatcher.Dispose();
+        }
+
+        private void OnFrame(uint data1, uint data2, DateTime time)
+        {
+            SpiFrameEventHandler handler = FrameReceived;
+            if (handler != null) handler(this, (int)data1, (int)data2, time);
+        }
+
+        private static void CheckRange(byte[] buffer, int offset, int count)
+        {
+            if (buffer == null) throw new ArgumentNullException();
+            if (offset < 0 || count < 0 || offset + count > buffer.Length)
+                throw new ArgumentOutOfRangeException();
+        }
+
+        [MethodImplAttribute(MethodImplOptions.InternalCall)]
+        private static extern int NativeAvailable(int port);
+
+        [MethodImplAttribute(MethodImplOptions.InternalCall)]
+        private static extern int NativeRead(int port, byte[] buffer, int offset, int count);
+
+        [MethodImplAttribute(MethodImplOptions.InternalCall)]
+        private static extern int NativeWrite(int port, byte[] buffer, int offset, int count);
+    }
+}
@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////
+// Spifi.cs - SPIFI flash information and read benchmarks for NXP LPC43XX
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Copyright (c) Microsoft Corporation.  All rights reserved.
+// Ported to NXP LPC43XX by Micromint USA <support@micromint.com>
+////////////////////////////////////////////////////////////////////////////////
+using System;
+using System.Runtime.CompilerServices;
+
+namespace Microsoft.SPOT.Hardware.LPC43XX
+{
+    /// <summary>
+    /// Parameters of the SPIFI flash the firmware runs from, as detected at
+    /// startup, and read throughput measurements.
+    /// </summary>
+    public sealed class Spifi
+    {
+        // Must match the order in NativeGetInfo
+        private const int InfoCount = 4;
+
+        public uint JedecId;        // Manufacturer in bits 16-23, device in bits 0-15
+        public uint Size;           // Bytes
+        public uint ClockKHz;       // SPIFI clock
+        public bool ContinuousRead; // Memory mode reads skip the opcode
+
+        private Spifi() { }
+
+        /// <summary>
+        /// Reads the flash parameters.
+        /// </summary>
+        public static Spifi GetInfo()
+        {
+            uint[] data = new uint[InfoCount];
+
+            NativeGetInfo(data);
+
+            Spifi info = new Spifi();
+            info.JedecId = data[0];
+            info.Size = data[1];
+            info.ClockKHz = data[2];
+            info.ContinuousRead = data[3] != 0;
+            return info;
+        }
+
+        /// <summary>
+        /// Times a memory mapped read of length bytes at offset in the flash,
+        /// in KB/s. Measures the SPIFI itself, the data is not returned.
+        /// </summary>
+        public static int ReadKBps(int offset, int length)
+        {
+            int kbps = NativeReadKBps(offset, length);
+
+            if (kbps < 0)
+                throw new ArgumentOutOfRangeException();
+            return kbps;
+        }
+
+        /// <summary>
+        /// Runs an interpreted loop for about the given time and returns the
+        /// loop iterations per second. The CLR executes from SPIFI, so the
+        /// result follows the XIP speed.
+        /// </summary>
+        public static int Benchmark(int milliseconds)
+        {
+            int[] data = new int[16];
+            long start = Utility.GetMachineTime().Ticks;
+            long end = start + (long)milliseconds * TimeSpan.TicksPerMillisecond;
+            long now;
+            int count = 0;
+
+            do
+            {
+                for (int i = 0; i < 256; i++)
+                    data[i & 15] += Step(i, data[(i + 1) & 15]);
+                count += 256;
+                now = Utility.GetMachineTime().Ticks;
+            } while (now < end);
+
+            return (int)((long)count * TimeSpan.TicksPerSecond / (now - start));
+        }
+
+        private static int Step(int a, int b)
+        {
+            return (a ^ b) + (b >> 3);
+        }
+
+        [MethodImplAttribute(MethodImplOptions.InternalCall)]
+        private static extern void NativeGetInfo(uint[] info);
+
+        [MethodImplAttribute(MethodImplOptions.InternalCall)]
+        private static extern int NativeReadKBps(int offset, int length);
+    }
+}
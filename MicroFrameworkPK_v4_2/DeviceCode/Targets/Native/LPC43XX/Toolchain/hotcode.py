@@ -0,0 +1,235 @@
+################################################################################
+# hotcode.py - Hot code list from PC samples for NXP LPC43XX
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# Copyright (c) Micromint USA. All rights reserved.
+################################################################################
+#
+# Ranks functions by the PC samples printed when LPC43XX_PC_SAMPLE_HZ is set
+# and picks the ones worth running from SRAM.
+#
+#   1. Build with LPC43XX_PC_SAMPLE_HZ (1000 is plenty) in platform_selector.h
+#   2. Run the managed workload and save the debug output from PCSAMPLE to
+#      PCSAMPLE END to a file
+#   3. python hotcode.py samples.txt TinyCLR.map [--budget 16384]
+#                        [--exclude regex]
+#                        [--update TinyCLR.sct scatterfile_tinyclr_mdk.xml]
+#   4. Rebuild without LPC43XX_PC_SAMPLE_HZ
+#
+# The map is the armlink listing with --map --symbols. The functions chosen go
+# between the hot code markers in ER_RAM_RO of the MDK scatter files as their
+# --split_sections input sections (i.name). ER_RAM_RO, ER_RAM_RW and the zero
+# initialized data share IRAM2 below ER_STACK, armlink reports an overlap if
+# the budget is too large.
+#
+# For GCC builds pass the output of arm-none-eabi-nm -S -n instead of the map.
+# GNU ld gives function sections to the first (.text*) rule, so the ranking is
+# only a guide for tagging functions with __section(SectionForHotCode).
+#
+# Code run before PrepareImageRegions copies ER_RAM_RO, and library code
+# without its own section, can't be moved and is never picked. Neither are
+# interrupt handlers and the HAL code they call: SPIFI command mode only masks
+# handlers whose vectors point into flash, so one moved to SRAM would still
+# run during a flash operation and call into flash. Callees are matched by
+# name, add driver functions used from interrupts with --exclude.
+
+import bisect
+import re
+import sys
+
+SAMPLE_HEADER = re.compile(r'PCSAMPLE ([0-9a-fA-F]+) (\d+) (\d+) (\d+)')
+SAMPLE_LINE = re.compile(r'PCS ([0-9a-fA-F]+) (\d+)')
+MAP_SYMBOL = re.compile(r'^\s*(\S.*?)\s+0x([0-9a-fA-F]{8})\s+(?:Thumb|ARM) Code\s+(\d+)\s+\S+?\((\S+)\)\s*$')
+NM_SYMBOL = re.compile(r'^([0-9a-fA-F]{8}) ([0-9a-fA-F]{8}) [tTwW] (\S+)$')
+
+# Run before the copy to SRAM
+BOOT = r'EntryPoint|BootEntry|BootstrapCode|PrepareImageRegions|SystemInit|SystemSetup'
+# Interrupt handlers and the HAL functions on the interrupt path
+ISR = (r'[Hh]andler|IRQ|Irq|ISR|Isr|Interrupt|Fault|INTC|systimer|HAL_Time_|PCSAMPLE|'
+       r'HAL_COMPLETION|HAL_CONTINUATION|Completion|Continuation|DequeueAndExec|'
+       r'SmartPtr_IRQ|Events_Set|GPDMA_|USART_Dma|SPI_Async')
+EXCLUDE = re.compile(BOOT + '|' + ISR)
+
+BEGIN_MARK = 'Hot code list'
+END_MARK = 'End of hot code list'
+
+
+def usage():
+    sys.stderr.write('usage: hotcode.py samples map [--budget bytes] [--min samples] [--top n] [--exclude regex] [--update file ...]\n')
+    sys.exit(2)
+
+
+# Bucket counts of the last complete sample run
+def read_samples(path):
+    runs = []
+    run = None
+    for line in open(path):
+        m = SAMPLE_HEADER.search(line)
+        if m:
+            run = {'shift': int(m.group(2)), 'total': int(m.group(3)),
+                   'other': int(m.group(4)), 'buckets': []}
+            continue
+        if run is None:
+            continue
+        if 'PCSAMPLE END' in line:
+            runs.append(run)
+            run = None
+            continue
+        m = SAMPLE_LINE.search(line)
+        if m:
+            run['buckets'].append((int(m.group(1), 16), int(m.group(2))))
+    if not runs:
+        sys.exit('%s: no complete PCSAMPLE output' % path)
+    return runs[-1]
+
+
+# Code symbols as (address, size, name, section), section None if not movable
+def read_symbols(path):
+    symbols = {}
+    for line in open(path):
+        line = line.rstrip('\r\n')
+        m = MAP_SYMBOL.match(line)
+        if m:
+            name, address, size, section = m.group(1), int(m.group(2), 16) & ~1, int(m.group(3)), m.group(4)
+            if not section.startswith('i.'):
+                section = None
+        else:
+            m = NM_SYMBOL.match(line)
+            if not m:
+                continue
+            address, size, name = int(m.group(1), 16) & ~1, int(m.group(2), 16), m.group(3)
+            section = None
+        if size > 0:
+            symbols[address] = (address, size, name, section)
+    return sorted(symbols.values())
+
+
+# Spreads each bucket over the functions it covers by bytes of overlap
+def rank(run, symbols):
+    size = 1 << run['shift']
+    starts = [s[0] for s in symbols]
+    hits = {}
+    unknown = 0.0
+    for address, count in run['buckets']:
+        end = address + size
+        i = max(bisect.bisect_right(starts, address) - 1, 0)
+        covered = 0
+        parts = []
+        while i < len(symbols) and symbols[i][0] < end:
+            lo = max(address, symbols[i][0])
+            hi = min(end, symbols[i][0] + symbols[i][1])
+            if hi > lo:
+                parts.append((i, hi - lo))
+                covered += hi - lo
+            i += 1
+        for i, n in parts:
+            hits[i] = hits.get(i, 0.0) + count * float(n) / size
+        unknown += count * float(size - covered) / size
+    ranked = sorted(((samples, symbols[i]) for i, samples in hits.items()), key=lambda h: -h[0])
+    return ranked, unknown
+
+
+# Most samples per byte first until the budget is used
+def choose(ranked, budget, minimum, exclude):
+    movable = [h for h in ranked if h[1][3] and h[0] >= minimum and not exclude.search(h[1][2])]
+    movable.sort(key=lambda h: -h[0] / h[1][1])
+    chosen = []
+    used = 0
+    for samples, symbol in movable:
+        if used + symbol[1] <= budget:
+            chosen.append((samples, symbol))
+            used += symbol[1]
+    return chosen, used
+
+
+# Replaces the lines between the markers, keeping the file's line endings
+def update(path, chosen):
+    text = open(path, 'rb').read().decode('utf-8')
+    newline = '\r\n' if '\r\n' in text else '\n'
+    lines = text.split(newline)
+    xml = path.lower().endswith('.xml')
+    try:
+        begin = [i for i, l in enumerate(lines) if BEGIN_MARK in l and END_MARK not in l][0]
+        end = [i for i, l in enumerate(lines) if END_MARK in l][0]
+    except IndexError:
+        sys.exit('%s: no hot code markers in ER_RAM_RO' % path)
+    indent = lines[begin][:len(lines[begin]) - len(lines[begin].lstrip())]
+    entries = []
+    for samples, symbol in sorted(chosen, key=lambda h: h[1][3]):
+        if xml:
+            entries.append('%s<FileMapping Name="*" Options="(%s)" />' % (indent, symbol[3]))
+        else:
+            entries.append('%s* (%s)' % (indent, symbol[3]))
+    lines[begin + 1:end] = entries
+    open(path, 'wb').write(newline.join(lines).encode('utf-8'))
+
+
+def main(argv):
+    files = []
+    budget = 16384
+    minimum = 1
+    top = 40
+    exclude = EXCLUDE
+    targets = []
+    i = 0
+    while i < len(argv):
+        if argv[i] == '--budget' and i + 1 < len(argv):
+            budget = int(argv[i + 1], 0)
+            i += 2
+        elif argv[i] == '--min' and i + 1 < len(argv):
+            minimum = int(argv[i + 1])
+            i += 2
+        elif argv[i] == '--top' and i + 1 < len(argv):
+            top = int(argv[i + 1])
+            i += 2
+        elif argv[i] == '--exclude' and i + 1 < len(argv):
+            exclude = re.compile(exclude.pattern + '|' + argv[i + 1])
+            i += 2
+        elif argv[i] == '--update':
+            targets = argv[i + 1:]
+            break
+        elif argv[i].startswith('--'):
+            usage()
+        else:
+            files.append(argv[i])
+            i += 1
+    if len(files) != 2:
+        usage()
+
+    run = read_samples(files[0])
+    symbols = read_symbols(files[1])
+    if not symbols:
+        sys.exit('%s: no code symbols' % files[1])
+    ranked, unknown = rank(run, symbols)
+    total = max(run['total'], 1)
+
+    print('%d samples, %.1f%% outside the flash buckets (SRAM), %.1f%% without a symbol'
+          % (run['total'], 100.0 * run['other'] / total, 100.0 * unknown / total))
+    print('%8s %6s %6s  %s' % ('samples', '%', 'bytes', 'function'))
+    for samples, symbol in ranked[:top]:
+        print('%8.0f %6.2f %6d  %s%s' % (samples, 100.0 * samples / total, symbol[1], symbol[2],
+                                        '' if symbol[3] and not exclude.search(symbol[2]) else '  (fixed)'))
+
+    chosen, used = choose(ranked, budget, minimum, exclude)
+    moved = sum(h[0] for h in chosen)
+    print('')
+    print('%d functions, %d of %d bytes, %.1f%% of the samples move to SRAM'
+          % (len(chosen), used, budget, 100.0 * moved / total))
+    for path in targets:
+        update(path, chosen)
+        print('updated %s' % path)
+
+
+if __name__ == '__main__':
+    main(sys.argv[1:])
@@ -112,6 +112,140 @@ ERROR - WE SHOULD NOT INCLUDE THIS HEADER IF NOT BUILDING A LPC43XX PLATFORM
 
 #endif
 
+// USART RX FIFO trigger level per port: 0 = 1 char, 1 = 4, 2 = 8, 3 = 14
+#ifndef LPC43XX_USART0_RX_TRIGGER
+#define LPC43XX_USART0_RX_TRIGGER   2
+#endif
+#ifndef LPC43XX_USART1_RX_TRIGGER
+#define LPC43XX_USART1_RX_TRIGGER   2
+#endif
+#ifndef LPC43XX_USART2_RX_TRIGGER
+#define LPC43XX_USART2_RX_TRIGGER   2
+#endif
+#ifndef LPC43XX_USART3_RX_TRIGGER
+#define LPC43XX_USART3_RX_TRIGGER   2
+#endif
+// Characters written to the TX FIFO per interrupt, 1 to 16
+#ifndef LPC43XX_USART_TX_FIFO_FILL
+#define LPC43XX_USART_TX_FIFO_FILL  16
+#endif
+
+// USART ports with RS-485 driver enable at initialization, same bit layout.
+// USART0/2/3 only, requires the DIR pin below. Delay is in bit times.
+#ifndef LPC43XX_USART_RS485_PORTS
+#define LPC43XX_USART_RS485_PORTS   0
+#endif
+#ifndef LPC43XX_USART_RS485_DELAY
+#define LPC43XX_USART_RS485_DELAY   1
+#endif
+// RS-485 direction pins and SCU functions, board specific (0 = none)
+#ifndef LPC43XX_USART0_DIR_PIN
+#define LPC43XX_USART0_DIR_PIN      0
+#define LPC43XX_USART0_DIR_CONF     0
+#endif
+#ifndef LPC43XX_USART2_DIR_PIN
+#define LPC43XX_USART2_DIR_PIN      0
+#define LPC43XX_USART2_DIR_CONF     0
+#endif
+#ifndef LPC43XX_USART3_DIR_PIN
+#define LPC43XX_USART3_DIR_PIN      0
+#define LPC43XX_USART3_DIR_CONF     0
+#endif
+
+// USART ports using GPDMA for transmit, bit n for port n (COM1 = bit 0)
+#ifndef LPC43XX_USART_DMA_TX_PORTS
+#define LPC43XX_USART_DMA_TX_PORTS  0
+#endif
+// Size of the DMA transmit staging buffer for each port
+#ifndef LPC43XX_USART_DMA_TX_SIZE
+#define LPC43XX_USART_DMA_TX_SIZE   PLATFORM_DEPENDENT_TX_USART_BUFFER_SIZE
+#endif
+// USART ports using circular GPDMA for receive, same bit layout
+#ifndef LPC43XX_USART_DMA_RX_PORTS
+#define LPC43XX_USART_DMA_RX_PORTS  0
+#endif
+// Size of the circular DMA receive buffer for each port, split in 4 segments
+#ifndef LPC43XX_USART_DMA_RX_SIZE
+#define LPC43XX_USART_DMA_RX_SIZE   256
+#endif
+
+// SSP ports using GPDMA, bit n for SPI_mod n
+#ifndef LPC43XX_SPI_DMA_PORTS
+#define LPC43XX_SPI_DMA_PORTS       0
+#endif
+// Minimum frames in a transaction to use GPDMA, shorter ones are polled
+#ifndef LPC43XX_SPI_DMA_THRESHOLD
+#define LPC43XX_SPI_DMA_THRESHOLD   32
+#endif
+// Linked list items per direction, each moves up to 4095 frames
+#ifndef LPC43XX_SPI_DMA_LLI
+#define LPC43XX_SPI_DMA_LLI         8
+#endif
+// Register settings cached per SSP port, one per distinct clock and format
+#ifndef LPC43XX_SPI_CONFIG_CACHE
+#define LPC43XX_SPI_CONFIG_CACHE    4
+#endif
+// SPI slave DMA rings per port, split in 4 segments
+#ifndef LPC43XX_SPI_SLAVE_RX_SIZE
+#define LPC43XX_SPI_SLAVE_RX_SIZE   1024
+#endif
+#ifndef LPC43XX_SPI_SLAVE_TX_SIZE
+#define LPC43XX_SPI_SLAVE_TX_SIZE   512
+#endif
+// Most transactions in one managed SpiBatch.Execute call
+#ifndef LPC43XX_SPI_BATCH_MAX
+#define LPC43XX_SPI_BATCH_MAX       48
+#endif
+// Pin route of each SPI_mod (SSP0, SSP1, SPI), see SPI_Route. Can be
+// changed at runtime with CPU_SPI_SetRoute.
+#ifndef LPC43XX_SPI0_ROUTE
+#define LPC43XX_SPI0_ROUTE          0
+#endif
+#ifndef LPC43XX_SPI1_ROUTE
+#define LPC43XX_SPI1_ROUTE          0
+#endif
+#ifndef LPC43XX_SPI2_ROUTE
+#define LPC43XX_SPI2_ROUTE          0
+#endif
+// Least erase time between SPIFI erase suspends. A pending interrupt with its
+// handler in SPIFI suspends a longer erase so it can run, 0 disables. Only
+// Winbond parts are suspended. Others, or 0, erase blocks as 4K sectors to
+// keep each window short.
+#ifndef LPC43XX_SPIFI_RESUME_USEC
+#define LPC43XX_SPIFI_RESUME_USEC   200
+#endif
+// SPIFI flash translation layer. LOGICAL bytes from BASE are stored as a
+// wear leveled log in SIZE bytes of flash, the rest is spare for garbage
+// collection. SIZE 0 disables it.
+#ifndef LPC43XX_SPIFI_FTL_SIZE
+#define LPC43XX_SPIFI_FTL_BASE      0
+#define LPC43XX_SPIFI_FTL_SIZE      0
+#define LPC43XX_SPIFI_FTL_LOGICAL   0
+#endif
+// Smallest SPIFI read copied on GPDMA, shorter ones are copied by the CPU.
+// 0 disables, otherwise the GPDMA driver must be in the solution.
+#ifndef LPC43XX_SPIFI_DMA_THRESHOLD
+#define LPC43XX_SPIFI_DMA_THRESHOLD 0
+#endif
+
+// PC sampling profiler on SysTick at this rate, 13 Hz and up, 0 disables it.
+// Samples LPC43XX_PC_SAMPLE_SIZE bytes of code from the flash base in buckets
+// of 1 << LPC43XX_PC_SAMPLE_SHIFT bytes for LPC43XX_PC_SAMPLE_SECONDS, then
+// prints the counts for Toolchain\hotcode.py. Code run with interrupts off
+// is seen when they are enabled again.
+#ifndef LPC43XX_PC_SAMPLE_HZ
+#define LPC43XX_PC_SAMPLE_HZ        0
+#endif
+#ifndef LPC43XX_PC_SAMPLE_SECONDS
+#define LPC43XX_PC_SAMPLE_SECONDS   30
+#endif
+#ifndef LPC43XX_PC_SAMPLE_SIZE
+#define LPC43XX_PC_SAMPLE_SIZE      0x00060000
+#endif
+#ifndef LPC43XX_PC_SAMPLE_SHIFT
+#define LPC43XX_PC_SAMPLE_SHIFT     6
+#endif
+
 #define DEFAULT_CLOCK_DIV           1
 
 #if !defined(USART_TX_XOFF_TIMEOUT_INFINITE)
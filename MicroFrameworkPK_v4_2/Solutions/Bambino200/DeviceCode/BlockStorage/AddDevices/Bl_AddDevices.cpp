@@ -22,9 +22,15 @@
 extern struct BlockStorageDevice  g_LPC43XX_BS;
 extern struct IBlockStorageDevice g_LPC43XX_SPIFI_DeviceTable;
 extern struct BLOCK_CONFIG        g_LPC43XX_BS_Config;
+extern struct BlockStorageDevice  g_LPC43XX_FTL_BS;
+extern struct BLOCK_CONFIG        g_LPC43XX_FTL_BS_Config;
 
 void BlockStorage_AddDevices() {
     BlockStorageList::AddDevice( &g_LPC43XX_BS,
                                  &g_LPC43XX_SPIFI_DeviceTable,
                                  &g_LPC43XX_BS_Config, FALSE );
+    // Filesystem on the SPIFI FTL, a separate device as it is not XIP
+    BlockStorageList::AddDevice( &g_LPC43XX_FTL_BS,
+                                 &g_LPC43XX_SPIFI_DeviceTable,
+                                 &g_LPC43XX_FTL_BS_Config, FALSE );
 }
@@ -18,8 +18,10 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include <tinyhal.h>
 
+// Defaults, the driver replaces the codes with the JEDEC ID and reports
+// program and erase times from SFDP or measured
 #define FLASH_MANUFACTURER_CODE              0x00EF  // Winbond
-#define FLASH_DEVICE_CODE                    0x4016  // W32Q32FV
+#define FLASH_DEVICE_CODE                    0x4016  // W25Q32FV
 
 // Region 1: CLR                   -  6 * 64K blocks   (384K)
 #define FLASH_BASE_ADDRESS1                  0x14000000
@@ -33,17 +35,18 @@
 #define FLASH_BASE_ADDRESS3                  0x14070000
 #define FLASH_BLOCK_COUNT3                   9
 #define FLASH_BYTES_PER_BLOCK3               (64*1024)
-// Region 4: Filesystem            - 48 * 64K blocks (3,072K)
-#define FLASH_BASE_ADDRESS4                  0x14100000
-#define FLASH_BLOCK_COUNT4                   48
+// Filesystem device, not XIP   - 40 * 64K blocks (2,560K) on the FTL in 3,072K
+// The FTL starts empty, contents of the old in place layout are discarded.
+#define FLASH_BASE_ADDRESS4                  LPC43XX_SPIFI_FTL_BASE
 #define FLASH_BYTES_PER_BLOCK4               (64*1024)
+#define FLASH_BLOCK_COUNT4                   (LPC43XX_SPIFI_FTL_LOGICAL / FLASH_BYTES_PER_BLOCK4)
 
 #define FLASH_BYTES_PER_SECTOR               2
 #define FLASH_BLOCK_ERASE_TYPICAL_TIME_USEC  1000000 // not used
-#define FLASH_SECTOR_WRITE_TYPICAL_TIME_USEC 10      // not used
+#define FLASH_SECTOR_WRITE_TYPICAL_TIME_USEC 10      // until measured
 #define FLASH_BLOCK_ERASE_MAX_TIME_USEC      4000000 // not used
 #define FLASH_SECTOR_WRITE_MAX_TIME_USEC     100     // not used
-#define FLASH_BLOCK_ERASE_ACTUAL_TIME_USEC   10000   // not used
+#define FLASH_BLOCK_ERASE_ACTUAL_TIME_USEC   10000   // until measured
 
 // EBIU Information
 
@@ -62,7 +65,8 @@
 #define LPC43XX__SUPPORTS_XIP      TRUE
 #define LPC43XX__WRITE_PROTECTED   FALSE
 #define LPC43XX__SUPP_COPY_BACK    FALSE
-#define LPC43XX__NUM_REGIONS       4
+#define LPC43XX__NUM_REGIONS       3
+#define LPC43XX_FTL__NUM_REGIONS   1
 
 #if defined(BUILD_RTM)
         #define MEMORY_BLOCKTYPE_SPECIAL  BlockRange::BLOCKTYPE_DEPLOYMENT
@@ -88,7 +92,7 @@ const BlockRange g_LPC43XX_BlockRange3[] =
 
 const BlockRange g_LPC43XX_BlockRange4[] =
 {
-    { BlockRange::BLOCKTYPE_FILESYSTEM,   0, 47},  // 0x14100000 Filesystem 3,072k
+    { BlockRange::BLOCKTYPE_FILESYSTEM,   0, FLASH_BLOCK_COUNT4 - 1},  // 0x14100000 Filesystem 2,560k
 };
 
 const BlockRegionInfo  g_LPC43XX_BlkRegion[LPC43XX__NUM_REGIONS] = 
@@ -115,13 +119,17 @@ const BlockRegionInfo  g_LPC43XX_BlkRegion[LPC43XX__NUM_REGIONS] =
         FLASH_BYTES_PER_BLOCK3, // UINT32        BytesPerBlock;   // Total number of bytes per block
         ARRAYSIZE_CONST_EXPR(g_LPC43XX_BlockRange3),
         g_LPC43XX_BlockRange3,
-    },
+    }
+};
 
+// Pages are only reached through the FTL, never through the memory map
+const BlockRegionInfo  g_LPC43XX_FTL_BlkRegion[LPC43XX_FTL__NUM_REGIONS] = 
+{
     {
         FLASH_BASE_ADDRESS4,    // ByteAddress   Start;           // Starting Sector address
         FLASH_BLOCK_COUNT4,     // UINT32        NumBlocks;       // total number of blocks in this region
         FLASH_BYTES_PER_BLOCK4, // UINT32        BytesPerBlock;   // Total number of bytes per block
-        ARRAYSIZE_CONST_EXPR(g_LPC43XX_BlockRange3),
+        ARRAYSIZE_CONST_EXPR(g_LPC43XX_BlockRange4),
         g_LPC43XX_BlockRange4,
     }
 };
@@ -144,6 +152,24 @@ const BlockDeviceInfo g_LPC43XX_DeviceInfo=
     g_LPC43XX_BlkRegion,                   // const BlockRegionInfo* pRegions;
 };
 
+const BlockDeviceInfo g_LPC43XX_FTL_DeviceInfo=
+{
+    {  
+        LPC43XX__IS_REMOVABLE,             // BOOL Removable;
+        FALSE,                             // BOOL SupportsXIP;
+        LPC43XX__WRITE_PROTECTED,          // BOOL WriteProtected;
+        LPC43XX__SUPP_COPY_BACK            // BOOL SupportsCopyBack
+    },
+    FLASH_SECTOR_WRITE_TYPICAL_TIME_USEC,  // UINT32 MaxSectorWrite_uSec;
+    FLASH_BLOCK_ERASE_ACTUAL_TIME_USEC,    // UINT32 MaxBlockErase_uSec;
+    FLASH_BYTES_PER_SECTOR,                // UINT32 BytesPerSector;     
+
+    LPC43XX_SPIFI_FTL_LOGICAL,             // UINT32 Size;
+
+    LPC43XX_FTL__NUM_REGIONS,              // UINT32 NumRegions;
+    g_LPC43XX_FTL_BlkRegion,               // const BlockRegionInfo* pRegions;
+};
+
 struct MEMORY_MAPPED_NOR_BLOCK_CONFIG g_LPC43XX_BS_Config =
 {
     { // BLOCK_CONFIG
@@ -173,11 +199,41 @@ struct MEMORY_MAPPED_NOR_BLOCK_CONFIG g_LPC43XX_BS_Config =
     FLASH_DEVICE_CODE,                     // UINT32 DeviceCode;
 };
 
+struct MEMORY_MAPPED_NOR_BLOCK_CONFIG g_LPC43XX_FTL_BS_Config =
+{
+    { // BLOCK_CONFIG
+        {
+            LPC43XX__WP_GPIO_PIN,          // GPIO_PIN             Pin;
+            LPC43XX__WP_ACTIVE,            // BOOL                 ActiveState;
+        },
+
+        &g_LPC43XX_FTL_DeviceInfo,         // BlockDeviceinfo
+    },
+
+    { // CPU_MEMORY_CONFIG
+        LPC43XX__CHIP_SELECT,              // UINT8  CPU_MEMORY_CONFIG::ChipSelect;
+        TRUE,                              // UINT8  CPU_MEMORY_CONFIG::ReadOnly;
+        LPC43XX__WAIT_STATES,              // UINT32 CPU_MEMORY_CONFIG::WaitStates;
+        LPC43XX__RELEASE_COUNTS,           // UINT32 CPU_MEMORY_CONFIG::ReleaseCounts;
+        LPC43XX__BIT_WIDTH,                // UINT32 CPU_MEMORY_CONFIG::BitWidth;
+        LPC43XX_SPIFI_FTL_BASE,            // UINT32 CPU_MEMORY_CONFIG::BaseAddress;
+        LPC43XX_SPIFI_FTL_LOGICAL,         // UINT32 CPU_MEMORY_CONFIG::SizeInBytes;
+        0,                                 // UINT8  CPU_MEMORY_CONFIG::XREADYEnable 
+        0,                                 // UINT8  CPU_MEMORY_CONFIG::ByteSignalsForRead 
+        0,                                 // UINT8  CPU_MEMORY_CONFIG::ExternalBufferEnable
+    },
+
+    0,                                     // UINT32 ChipProtection;
+    FLASH_MANUFACTURER_CODE,               // UINT32 ManufacturerCode;
+    FLASH_DEVICE_CODE,                     // UINT32 DeviceCode;
+};
+
 #if defined(ADS_LINKER_BUG__NOT_ALL_UNUSED_VARIABLES_ARE_REMOVED)
 #pragma arm section rodata = "g_LPC43XX_BS"
 #endif
 
 struct BlockStorageDevice g_LPC43XX_BS;
+struct BlockStorageDevice g_LPC43XX_FTL_BS;
 
 #if defined(ADS_LINKER_BUG__NOT_ALL_UNUSED_VARIABLES_ARE_REMOVED)
 #pragma arm section rodata 
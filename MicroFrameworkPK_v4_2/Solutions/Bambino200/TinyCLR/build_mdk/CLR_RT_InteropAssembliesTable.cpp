@@ -15,6 +15,8 @@ extern const CLR_RT_NativeAssemblyData g_CLR_AssemblyNative_Microsoft_SPOT_Hardw
 extern const CLR_RT_NativeAssemblyData g_CLR_AssemblyNative_Microsoft_SPOT_Hardware_PWM;
 extern const CLR_RT_NativeAssemblyData g_CLR_AssemblyNative_Microsoft_SPOT_IO;
 extern const CLR_RT_NativeAssemblyData g_CLR_AssemblyNative_System_Xml;
+extern const CLR_RT_NativeAssemblyData g_CLR_AssemblyNative_Microsoft_SPOT_Hardware_LPC43XX;
+extern const CLR_RT_NativeAssemblyData g_CLR_AssemblyNative_LPC43XX_SpiSlave;
  
 const CLR_RT_NativeAssemblyData *g_CLR_InteropAssembliesNativeData[] =
 {
@@ -29,6 +31,8 @@ const CLR_RT_NativeAssemblyData *g_CLR_InteropAssembliesNativeData[] =
     &g_CLR_AssemblyNative_Microsoft_SPOT_Hardware_PWM,
     &g_CLR_AssemblyNative_Microsoft_SPOT_IO,
     &g_CLR_AssemblyNative_System_Xml,
+    &g_CLR_AssemblyNative_Microsoft_SPOT_Hardware_LPC43XX,
+    &g_CLR_AssemblyNative_LPC43XX_SpiSlave,
     NULL
 };
 // End of C:\MicroFrameworkPK_v4_2\BuildOutput\THUMB2\MDK4.71\le\FLASH\release\Bambino200\obj\Solutions\Bambino200\TinyCLR\CLR_RT_InteropAssembliesTable.cpp
@@ -61,6 +61,14 @@
 
 #define INSTRUMENTATION_H_GPIO_PIN      0
 
+#define LPC43XX_USART_DMA_TX_PORTS      (1 << 1)   // COM2 transmit via GPDMA
+#define LPC43XX_USART_DMA_RX_PORTS      (1 << 1)   // COM2 receive via GPDMA
+#define LPC43XX_SPI_DMA_PORTS           (1 << 0)   // SPI1 (SSP0) via GPDMA
+#define LPC43XX_SPIFI_FTL_BASE          0x14100000 // Filesystem region
+#define LPC43XX_SPIFI_FTL_SIZE          0x00300000 // 3M of flash
+#define LPC43XX_SPIFI_FTL_LOGICAL       0x00280000 // 2.5M for the filesystem
+#define LPC43XX_SPIFI_DMA_THRESHOLD     2048       // SPIFI reads from 2K via GPDMA
+
 #ifndef DEBUG_SERIAL
   #define DEBUG_TEXT_PORT    USB1
   #define STDIO              USB1